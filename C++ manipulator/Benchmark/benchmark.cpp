@@ -0,0 +1,165 @@
+#include "../robodk_api.h"
+#include "../Mock/mock_robodk.h"
+#include <QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+#ifndef RDK_SKIP_NAMESPACE
+using namespace RoboDK_API;
+#endif
+
+// Round trip latency of one call, repeated count times
+static void latency(const char *name, int count, const std::function<void(int)> &call){
+    std::vector<qint64> nsec(count);
+    QElapsedTimer total;
+    total.start();
+    for (int i=0; i<count; i++){
+        QElapsedTimer timer;
+        timer.start();
+        call(i);
+        nsec[i] = timer.nsecsElapsed();
+    }
+    double seconds = total.nsecsElapsed() * 1e-9;
+    std::sort(nsec.begin(), nsec.end());
+    double mean = 0;
+    for (int i=0; i<count; i++){
+        mean += nsec[i];
+    }
+    mean /= count;
+    printf("%-24s %10.1f %10.1f %10.1f %12.0f\n", name, mean * 1e-3, nsec[count/2] * 1e-3, nsec[(count*99)/100] * 1e-3, count / seconds);
+}
+
+// Throughput of calls that move size bytes each
+static void throughput(const char *name, int count, double bytes, const std::function<void()> &call){
+    QElapsedTimer timer;
+    timer.start();
+    for (int i=0; i<count; i++){
+        call();
+    }
+    double seconds = timer.nsecsElapsed() * 1e-9;
+    printf("%-24s %10.1f ms/call %10.1f MB/s\n", name, seconds * 1e3 / count, count * bytes / seconds / 1e6);
+}
+
+// Benchmark of the RoboDK API over loopback: benchmark [count] [port]
+// Without a port the mock RoboDK server is started in process on a free port.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+    int count = args.size() > 1 ? args[1].toInt() : 2000;
+    int port = args.size() > 2 ? args[2].toInt() : -1;
+
+    MockRoboDK mock;
+    if (port < 0){
+        if (!mock.Start(0)){
+            return 1;
+        }
+        port = mock.Port();
+    }
+
+    RoboDK rdk("127.0.0.1", port);
+    if (!rdk.Connected()){
+        printf("Cannot connect to RoboDK on port %d\n", port);
+        return 1;
+    }
+    Item robot = rdk.getItem("UR3", RoboDK::ITEM_TYPE_ROBOT);
+    Item program = rdk.getItem("Prog", RoboDK::ITEM_TYPE_PROGRAM);
+    if (!robot.Valid()){
+        printf("No UR3 robot in the station\n");
+        return 1;
+    }
+    const double home_values[6] = {0, -90, 90, -90, -90, 0};
+    tJoints home(home_values, 6);
+    robot.setJoints(home);
+    Mat pose = robot.SolveFK(home);
+
+    printf("%-24s %10s %10s %10s %12s\n", "round trip", "mean us", "p50 us", "p99 us", "calls/s");
+    latency("Joints", count, [&](int){ robot.Joints(); });
+    latency("SolveFK", count, [&](int){ robot.SolveFK(home); });
+    latency("SolveIK", count, [&](int){ robot.SolveIK(pose); });
+    latency("MoveJ", count, [&](int i){
+        double values[6] = {i % 2 ? 10.0 : -10.0, -90, 90, -90, -90, 0};
+        robot.MoveJ(tJoints(values, 6));
+    });
+    latency("MoveJ_Test", qMax(1, count / 10), [&](int){
+        double values[6] = {90, -60, 60, -90, -90, 0};
+        robot.MoveJ_Test(home, tJoints(values, 6));
+    });
+
+    // statuses collected at the end instead of after every command
+    QElapsedTimer timer;
+    timer.start();
+    rdk.BatchStart();
+    for (int i=0; i<count; i++){
+        robot.setJoints(home);
+    }
+    rdk.BatchEnd();
+    printf("%-24s %10.0f msg/s\n", "setJoints (batch)", count / (timer.nsecsElapsed() * 1e-9));
+
+    printf("\n");
+    if (program.Valid()){
+        tMatrix2D *joint_list = NULL;
+        QString error_msg;
+        program.InstructionListJoints(error_msg, &joint_list);
+        double bytes = Matrix2D_Size(joint_list, 1) * Matrix2D_Size(joint_list, 2) * sizeof(double);
+        Matrix2D_Delete(&joint_list);
+        throughput("InstructionListJoints", 20, bytes, [&](){
+            tMatrix2D *list = NULL;
+            program.InstructionListJoints(error_msg, &list);
+            Matrix2D_Delete(&list);
+        });
+    }
+    const int npoints = 100000;
+    tMatrix2D *points = Matrix2D_Create();
+    Matrix2D_Set_Size(points, 3, npoints);
+    for (int i=0; i<3*npoints; i++){
+        points->data[i] = i % 1000;
+    }
+    throughput("AddPoints (100k)", 20, 3.0 * npoints * sizeof(double), [&](){
+        Item cloud = rdk.AddPoints(points, NULL, false, RoboDK::PROJECTION_NONE);
+        cloud.Delete();
+    });
+    Matrix2D_Delete(&points);
+
+    // one link per worker thread
+    printf("\n");
+    for (int nthreads=1; nthreads<=8; nthreads*=2){
+        RoboDKPool pool(nthreads, "127.0.0.1", port);
+        int per_thread = count / nthreads;
+        std::vector<std::thread> workers;
+        QElapsedTimer pool_timer;
+        pool_timer.start();
+        for (int t=0; t<nthreads; t++){
+            workers.push_back(std::thread([&](){
+                Item worker_robot = pool.Route(robot);
+                if (!worker_robot.Valid()){
+                    printf("worker could not connect\n");
+                    return;
+                }
+                for (int i=0; i<per_thread; i++){
+                    worker_robot.SolveIK(pose);
+                }
+                pool.Release();
+            }));
+        }
+        for (size_t t=0; t<workers.size(); t++){
+            workers[t].join();
+        }
+        printf("SolveIK, %d connections %10.0f calls/s\n", nthreads, nthreads * per_thread / (pool_timer.nsecsElapsed() * 1e-9));
+    }
+
+    // for comparison: no round trip at all. Without joints_approx SolveIK asks
+    // RoboDK for the current joints, so they are passed in.
+    if (robot.setKinematicsUR(KinematicsUR::UR3())){
+        latency("SolveIK (local)", count, [&](int){ robot.SolveIK(pose, home); });
+    }
+
+    if (mock.Port() != 0){
+        printf("\nmock server: %lld commands\n", mock.Commands());
+    }
+    return 0;
+}
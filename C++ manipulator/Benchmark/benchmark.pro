@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Round trip and throughput benchmark of the RoboDK API, against the mock server
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT += network
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = robodk_benchmark
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+
+SOURCES += \
+        benchmark.cpp \
+    ../Mock/mock_robodk.cpp \
+    ../robodk_api.cpp
+
+HEADERS += \
+    ../Mock/mock_robodk.h \
+    ../robodk_api.h
+
+include(../robodk_ik_lanes.pri)
@@ -35,3 +35,5 @@ HEADERS += \
 
 FORMS += \
         mainwindow.ui
+
+include(robodk_ik_lanes.pri)
@@ -1,6 +1,13 @@
 #include "robodk_api.h"
 #include <QtNetwork/QTcpSocket>
 #include <QtCore/QProcess>
+#include <QtCore/QtEndian>
+#include <QtCore/QVector>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QThread>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include <cmath>
 #include <algorithm>
 
@@ -550,6 +557,591 @@ Mat Mat::rotz(double rz){
 
 
 
+//----------------------------------- UR kinematics ------------------------
+// Row major 4x4 helpers for the local kinematics, in double precision
+static void _Pose_Mult(const double A[16], const double B[16], double C[16]){
+    for (int r=0; r<4; r++){
+        for (int c=0; c<4; c++){
+            C[r*4+c] = A[r*4]*B[c] + A[r*4+1]*B[4+c] + A[r*4+2]*B[8+c] + A[r*4+3]*B[12+c];
+        }
+    }
+}
+static void _Pose_Inv(const double A[16], double B[16]){
+    for (int r=0; r<3; r++){
+        for (int c=0; c<3; c++){
+            B[r*4+c] = A[c*4+r];
+        }
+        B[r*4+3] = -(A[r]*A[3] + A[4+r]*A[7] + A[8+r]*A[11]);
+    }
+    B[12] = 0; B[13] = 0; B[14] = 0; B[15] = 1;
+}
+// Standard DH link: Rz(theta) Tz(d) Tx(a) Rx(alpha)
+static void _Pose_DH(double T[16], double theta, double d, double a, double alpha){
+    double ct = cos(theta), st = sin(theta), ca = cos(alpha), sa = sin(alpha);
+    T[0] = ct; T[1] = -st*ca; T[2] = st*sa;  T[3] = a*ct;
+    T[4] = st; T[5] = ct*ca;  T[6] = -ct*sa; T[7] = a*st;
+    T[8] = 0;  T[9] = sa;     T[10] = ca;    T[11] = d;
+    T[12] = 0; T[13] = 0;     T[14] = 0;     T[15] = 1;
+}
+
+KinematicsUR::KinematicsUR(double d1, double a2, double a3, double d4, double d5, double d6){
+    _D1 = d1;
+    _A2 = a2;
+    _A3 = a3;
+    _D4 = d4;
+    _D5 = d5;
+    _D6 = d6;
+    for (int i=0; i<16; i++){
+        _Base[i] = (i % 5 == 0) ? 1.0 : 0.0;
+        _BaseInv[i] = _Base[i];
+    }
+    for (int i=0; i<6; i++){
+        _Lower[i] = -360.0;
+        _Upper[i] = 360.0;
+    }
+}
+KinematicsUR KinematicsUR::UR3(){
+    return KinematicsUR(151.9, -243.65, -213.25, 112.35, 85.35, 81.9);
+}
+KinematicsUR KinematicsUR::UR5(){
+    return KinematicsUR(89.159, -425.0, -392.25, 109.15, 94.65, 82.3);
+}
+KinematicsUR KinematicsUR::UR10(){
+    return KinematicsUR(127.3, -612.0, -572.3, 163.941, 115.7, 92.2);
+}
+void KinematicsUR::setBase(const Mat &base){
+    for (int r=0; r<4; r++){
+        for (int c=0; c<4; c++){
+            _Base[r*4+c] = base.Get(r,c);
+        }
+    }
+    _Pose_Inv(_Base, _BaseInv);
+}
+void KinematicsUR::setJointLimits(const tJoints &lower, const tJoints &upper){
+    for (int i=0; i<6 && i<lower.Length() && i<upper.Length(); i++){
+        _Lower[i] = lower.ValuesD()[i];
+        _Upper[i] = upper.ValuesD()[i];
+    }
+}
+Mat KinematicsUR::SolveFK(const tJoints &joints) const{
+    double q[6] = {0, 0, 0, 0, 0, 0};
+    for (int i=0; i<6 && i<joints.Length(); i++){
+        q[i] = joints.ValuesD()[i] * M_PI / 180.0;
+    }
+    double flange[16], pose[16];
+    _fk(q, flange);
+    _Pose_Mult(_Base, flange, pose);
+    Mat mat;
+    for (int r=0; r<4; r++){
+        for (int c=0; c<4; c++){
+            mat.Set(r, c, pose[r*4+c]);
+        }
+    }
+    return mat;
+}
+int KinematicsUR::SolveIK_All(const Mat &pose, tJoints solutions[8]) const{
+    double target[16], flange[16];
+    for (int r=0; r<4; r++){
+        for (int c=0; c<4; c++){
+            target[r*4+c] = pose.Get(r,c);
+        }
+    }
+    _Pose_Mult(_BaseInv, target, flange);
+    double q[8][6];
+    int nq = _ik(flange, q);
+    int nsol = 0;
+    for (int s=0; s<nq; s++){
+        double joints[6];
+        for (int i=0; i<6; i++){
+            joints[i] = q[s][i] * 180.0 / M_PI;
+        }
+        if (_inLimits(joints, NULL)){
+            solutions[nsol++] = tJoints(joints, 6);
+        }
+    }
+    return nsol;
+}
+bool KinematicsUR::SolveIK(const Mat &pose, const tJoints &joints_approx, tJoints &joints) const{
+    tJoints solutions[8];
+    int nsol = SolveIK_All(pose, solutions);
+    double best = -1;
+    for (int s=0; s<nsol; s++){
+        double *values = solutions[s].Data();
+        _inLimits(values, joints_approx.Length() >= 6 ? joints_approx.ValuesD() : NULL);
+        double dist = 0;
+        for (int i=0; i<6 && i<joints_approx.Length(); i++){
+            double d = values[i] - joints_approx.ValuesD()[i];
+            dist += d*d;
+        }
+        if (best < 0 || dist < best){
+            best = dist;
+            joints = solutions[s];
+        }
+    }
+    return nsol > 0;
+}
+void KinematicsUR::_fk(const double q[6], double pose[16]) const{
+    const double d[6] = {_D1, 0, 0, _D4, _D5, _D6};
+    const double a[6] = {0, _A2, _A3, 0, 0, 0};
+    const double alpha[6] = {M_PI/2, 0, 0, M_PI/2, -M_PI/2, 0};
+    double link[16], prod[16];
+    _Pose_DH(pose, q[0], d[0], a[0], alpha[0]);
+    for (int i=1; i<6; i++){
+        _Pose_DH(link, q[i], d[i], a[i], alpha[i]);
+        _Pose_Mult(pose, link, prod);
+        memcpy(pose, prod, sizeof(prod));
+    }
+}
+// Every DH frame with respect to the robot base: the DH base, then one frame per joint
+void KinematicsUR::_fk_Frames(const double q[6], double frames[7][16]) const{
+    const double d[6] = {_D1, 0, 0, _D4, _D5, _D6};
+    const double a[6] = {0, _A2, _A3, 0, 0, 0};
+    const double alpha[6] = {M_PI/2, 0, 0, M_PI/2, -M_PI/2, 0};
+    double link[16];
+    memcpy(frames[0], _Base, sizeof(_Base));
+    for (int i=0; i<6; i++){
+        _Pose_DH(link, q[i], d[i], a[i], alpha[i]);
+        _Pose_Mult(frames[i], link, frames[i+1]);
+    }
+}
+// Closed form inverse (Hawkins, "Analytic Inverse Kinematics for the Universal
+// Robots UR-5/UR-10 Arms"): the shoulder from the wrist centre, the wrist from
+// the flange orientation, then a planar 2R problem for the parallel joints.
+int KinematicsUR::_ik(const double T[16], double q[8][6]) const{
+    int nsol = 0;
+    // wrist centre (origin of frame 5)
+    double px = T[3] - _D6*T[2];
+    double py = T[7] - _D6*T[6];
+    double radius = sqrt(px*px + py*py);
+    if (radius < fabs(_D4)){
+        return 0;
+    }
+    double psi = atan2(py, px);
+    double phi = asin(_D4 / radius);
+    const double shoulder[2] = {psi + phi, psi + M_PI - phi};
+    for (int i=0; i<2; i++){
+        double t1 = shoulder[i];
+        double s1 = sin(t1), c1 = cos(t1);
+        double c5 = (T[3]*s1 - T[7]*c1 - _D4) / _D6;
+        if (fabs(c5) > 1.0){
+            continue;
+        }
+        for (int j=0; j<2; j++){
+            double t5 = j == 0 ? acos(c5) : -acos(c5);
+            double s5 = sin(t5);
+            // with the wrist aligned joint 6 is free: keep it at 0
+            double t6 = 0;
+            if (fabs(s5) > 1e-9){
+                t6 = atan2(-(T[1]*s1 - T[5]*c1)/s5, (T[0]*s1 - T[4]*c1)/s5);
+            }
+            // T14 = A1^-1 T A6^-1 A5^-1 only depends on joints 2 to 4
+            double a1[16], a5[16], a6[16], inv[16], tmp[16], t14[16];
+            _Pose_DH(a1, t1, _D1, 0, M_PI/2);
+            _Pose_DH(a5, t5, _D5, 0, -M_PI/2);
+            _Pose_DH(a6, t6, _D6, 0, 0);
+            _Pose_Inv(a1, inv);
+            _Pose_Mult(inv, T, tmp);
+            _Pose_Inv(a6, inv);
+            _Pose_Mult(tmp, inv, t14);
+            _Pose_Inv(a5, inv);
+            _Pose_Mult(t14, inv, tmp);
+            memcpy(t14, tmp, sizeof(tmp));
+            // origin of frame 3 in frame 1
+            double qx = t14[3] - _D4*t14[1];
+            double qy = t14[7] - _D4*t14[5];
+            double c3 = (qx*qx + qy*qy - _A2*_A2 - _A3*_A3) / (2*_A2*_A3);
+            if (fabs(c3) > 1.0){
+                continue;
+            }
+            for (int k=0; k<2; k++){
+                double t3 = k == 0 ? acos(c3) : -acos(c3);
+                double t2 = atan2(qy, qx) - atan2(_A3*sin(t3), _A2 + _A3*cos(t3));
+                double t4 = atan2(t14[4], t14[0]) - t2 - t3;
+                double *sol = q[nsol++];
+                sol[0] = t1;
+                sol[1] = t2;
+                sol[2] = t3;
+                sol[3] = t4;
+                sol[4] = t5;
+                sol[5] = t6;
+            }
+        }
+    }
+    return nsol;
+}
+int KinematicsUR::SolveIK_Batch(const Mat *poses, int count, const tJoints &joints_approx, tIKResult *results, int nthreads) const{
+    if (nthreads <= 0){
+        nthreads = qMax(1, (int)std::thread::hardware_concurrency());
+    }
+    // threads only pay off for a few blocks each
+    int nblocks = qMax(1, qMin(nthreads, count / (16*IK_LANES)));
+    std::vector<std::thread> workers;
+    std::vector<int> feasible(nblocks, 0);
+    for (int b=1; b<nblocks; b++){
+        int first = (int)((qint64)b * count / nblocks);
+        int last = (int)((qint64)(b + 1) * count / nblocks);
+        workers.push_back(std::thread([=, &feasible, &joints_approx](){
+            feasible[b] = _solve_Block(poses + first, last - first, joints_approx, results + first);
+        }));
+    }
+    feasible[0] = _solve_Block(poses, count / nblocks, joints_approx, results);
+    int nfeasible = feasible[0];
+    for (int t=0; t<(int)workers.size(); t++){
+        workers[t].join();
+        nfeasible += feasible[t + 1];
+    }
+    return nfeasible;
+}
+int KinematicsUR::_solve_Block(const Mat *poses, int count, const tJoints &joints_approx, tIKResult *results) const{
+    const double *approx = joints_approx.Length() >= 6 ? joints_approx.ValuesD() : NULL;
+    int nfeasible = 0;
+    double T[16][IK_LANES];
+    double q[8][6][IK_LANES];
+    for (int first=0; first<count; first+=IK_LANES){
+        // spare lanes of the last group repeat its last pose
+        int nlanes = qMin((int)IK_LANES, count - first);
+        for (int l=0; l<IK_LANES; l++){
+            const Mat &pose = poses[first + qMin(l, nlanes - 1)];
+            double target[16], flange[16];
+            for (int r=0; r<4; r++){
+                for (int c=0; c<4; c++){
+                    target[r*4+c] = pose.Get(r,c);
+                }
+            }
+            _Pose_Mult(_BaseInv, target, flange);
+            for (int e=0; e<16; e++){
+                T[e][l] = flange[e];
+            }
+        }
+        _ik_Lanes(T, q);
+
+        for (int l=0; l<nlanes; l++){
+            tIKResult &result = results[first + l];
+            result.joints = tJoints();
+            result.branch = -1;
+            result.feasible = false;
+            double best = -1;
+            for (int b=0; b<8; b++){
+                double joints[6];
+                bool valid = true;
+                for (int i=0; i<6; i++){
+                    joints[i] = q[b][i][l] * 180.0 / M_PI;
+                    valid = valid && std::isfinite(joints[i]);
+                }
+                if (!valid || !_inLimits(joints, approx)){
+                    continue;
+                }
+                double dist = 0;
+                for (int i=0; approx != NULL && i<6; i++){
+                    dist += (joints[i] - approx[i])*(joints[i] - approx[i]);
+                }
+                if (best < 0 || dist < best){
+                    best = dist;
+                    result.joints = tJoints(joints, 6);
+                    result.branch = b;
+                    result.feasible = true;
+                }
+            }
+            if (result.feasible){
+                nfeasible++;
+            }
+        }
+    }
+    return nfeasible;
+}
+// Moves every joint by whole turns into (-180, 180], or as close to
+// joints_approx as possible, inside the joint limits. False if one does not fit.
+bool KinematicsUR::_inLimits(double *joints, const double *joints_approx) const{
+    for (int i=0; i<6; i++){
+        double value = remainder(joints[i], 360.0);
+        if (joints_approx != NULL){
+            value += 360.0 * floor((joints_approx[i] - value) / 360.0 + 0.5);
+        }
+        while (value > _Upper[i] && value - 360.0 >= _Lower[i]){
+            value -= 360.0;
+        }
+        while (value < _Lower[i] && value + 360.0 <= _Upper[i]){
+            value += 360.0;
+        }
+        if (value < _Lower[i] || value > _Upper[i]){
+            return false;
+        }
+        joints[i] = value;
+    }
+    return true;
+}
+
+//----------------------------------- UR collision model ------------------------
+// Closest distance between the segments p1-q1 and p2-q2 (Ericson, Real-Time
+// Collision Detection, 5.1.9)
+static double _Segment_Distance(const double p1[3], const double q1[3], const double p2[3], const double q2[3]){
+    double d1[3], d2[3], r[3];
+    for (int i=0; i<3; i++){
+        d1[i] = q1[i] - p1[i];
+        d2[i] = q2[i] - p2[i];
+        r[i] = p1[i] - p2[i];
+    }
+    double a = d1[0]*d1[0] + d1[1]*d1[1] + d1[2]*d1[2];
+    double e = d2[0]*d2[0] + d2[1]*d2[1] + d2[2]*d2[2];
+    double f = d2[0]*r[0] + d2[1]*r[1] + d2[2]*r[2];
+    double s = 0, t = 0;
+    if (a <= 1e-12 && e <= 1e-12){
+        s = t = 0;
+    } else if (a <= 1e-12){
+        t = qBound(0.0, f / e, 1.0);
+    } else {
+        double c = d1[0]*r[0] + d1[1]*r[1] + d1[2]*r[2];
+        if (e <= 1e-12){
+            s = qBound(0.0, -c / a, 1.0);
+        } else {
+            double b = d1[0]*d2[0] + d1[1]*d2[1] + d1[2]*d2[2];
+            double denom = a*e - b*b;
+            s = denom > 1e-12 ? qBound(0.0, (b*f - c*e) / denom, 1.0) : 0.0;
+            t = (b*s + f) / e;
+            if (t < 0){
+                t = 0;
+                s = qBound(0.0, -c / a, 1.0);
+            } else if (t > 1){
+                t = 1;
+                s = qBound(0.0, (b - c) / a, 1.0);
+            }
+        }
+    }
+    double dist2 = 0;
+    for (int i=0; i<3; i++){
+        double diff = (p1[i] + d1[i]*s) - (p2[i] + d2[i]*t);
+        dist2 += diff*diff;
+    }
+    return sqrt(dist2);
+}
+static void _Pose_Point(const double pose[16], const double p[3], double out[3]){
+    for (int r=0; r<3; r++){
+        out[r] = pose[r*4]*p[0] + pose[r*4+1]*p[1] + pose[r*4+2]*p[2] + pose[r*4+3];
+    }
+}
+
+CollisionUR::CollisionUR(const KinematicsUR &kinematics){
+    _Kinematics = kinematics;
+}
+CollisionUR CollisionUR::UR3(const KinematicsUR &kinematics){
+    // Coarse envelope of the UR3 links in the DH frames. The links are offset
+    // along the joint axes: 119.85 at the shoulder, -92.5 at the elbow and
+    // 85 at the first wrist, which add up to d4.
+    CollisionUR model(kinematics);
+    const double d1 = 151.9, a2 = -243.65, a3 = -213.25, d4 = 112.35, d5 = 85.35, d6 = 81.9;
+    const double shoulder = 119.85, elbow = shoulder - 92.5;
+    const double links[8][8] = {
+        {0,   0, 0, 0,          0, 0, d1,        64}, // base
+        {1,   0, 0, 0,          0, 0, shoulder,  55}, // shoulder
+        {2, -a2, 0, shoulder,   0, 0, shoulder,  45}, // upper arm
+        {2,   0, 0, shoulder,   0, 0, elbow,     45}, // elbow
+        {3, -a3, 0, elbow,      0, 0, elbow,     38}, // forearm
+        {3,   0, 0, elbow,      0, 0, d4,        38}, // wrist 1
+        {4,   0, 0, 0,          0, 0, d5,        38}, // wrist 2
+        {5,   0, 0, 0,          0, 0, d6,        38}  // wrist 3 and flange
+    };
+    for (int i=0; i<8; i++){
+        model.addRobotCapsule((int)links[i][0], links[i] + 1, links[i] + 4, links[i][7]);
+    }
+    return model;
+}
+void CollisionUR::setKinematics(const KinematicsUR &kinematics){
+    _Kinematics = kinematics;
+}
+void CollisionUR::addRobotCapsule(int frame, const tXYZ p1, const tXYZ p2, double radius){
+    tCapsule capsule;
+    capsule.frame = qBound(0, frame, 6);
+    memcpy(capsule.p1, p1, sizeof(capsule.p1));
+    memcpy(capsule.p2, p2, sizeof(capsule.p2));
+    capsule.radius = radius;
+    _Robot.append(capsule);
+}
+void CollisionUR::addObstacleCapsule(const tXYZ p1, const tXYZ p2, double radius){
+    tCapsule capsule;
+    capsule.frame = -1;
+    memcpy(capsule.p1, p1, sizeof(capsule.p1));
+    memcpy(capsule.p2, p2, sizeof(capsule.p2));
+    capsule.radius = radius;
+    _Obstacles.append(capsule);
+}
+void CollisionUR::addObstaclePlane(const tXYZ normal, double offset){
+    double norm = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+    if (norm <= 0){
+        return;
+    }
+    tPlane plane;
+    for (int i=0; i<3; i++){
+        plane.normal[i] = normal[i] / norm;
+    }
+    plane.offset = offset / norm;
+    _Planes.append(plane);
+}
+void CollisionUR::clearObstacles(){
+    _Obstacles.clear();
+    _Planes.clear();
+}
+int CollisionUR::Collisions(const tJoints &joints) const{
+    double q[6] = {0, 0, 0, 0, 0, 0};
+    for (int i=0; i<6 && i<joints.Length(); i++){
+        q[i] = joints.ValuesD()[i] * M_PI / 180.0;
+    }
+    double frames[7][16];
+    _Kinematics._fk_Frames(q, frames);
+
+    // robot capsules in the robot base frame
+    const int nrobot = _Robot.size();
+    QVarLengthArray<double, 96> ends(nrobot*6);
+    for (int i=0; i<nrobot; i++){
+        const tCapsule &capsule = _Robot[i];
+        _Pose_Point(frames[capsule.frame], capsule.p1, ends.data() + i*6);
+        _Pose_Point(frames[capsule.frame], capsule.p2, ends.data() + i*6 + 3);
+    }
+
+    int npairs = 0;
+    for (int i=0; i<nrobot; i++){
+        const double *p1 = ends.data() + i*6, *q1 = p1 + 3;
+        const double radius = _Robot[i].radius;
+        for (int k=0; k<_Planes.size(); k++){
+            const tPlane &plane = _Planes[k];
+            double h1 = plane.normal[0]*p1[0] + plane.normal[1]*p1[1] + plane.normal[2]*p1[2] - plane.offset;
+            double h2 = plane.normal[0]*q1[0] + plane.normal[1]*q1[1] + plane.normal[2]*q1[2] - plane.offset;
+            if (qMin(h1, h2) < radius && _Robot[i].frame > 0){ // the base stands on the table
+                npairs++;
+            }
+        }
+        for (int k=0; k<_Obstacles.size(); k++){
+            const tCapsule &obstacle = _Obstacles[k];
+            if (_Segment_Distance(p1, q1, obstacle.p1, obstacle.p2) < radius + obstacle.radius){
+                npairs++;
+            }
+        }
+        // links on the same or neighbouring frames always touch
+        for (int j=i+1; j<nrobot; j++){
+            if (qAbs(_Robot[j].frame - _Robot[i].frame) <= 1){
+                continue;
+            }
+            const double *p2 = ends.data() + j*6, *q2 = p2 + 3;
+            if (_Segment_Distance(p1, q1, p2, q2) < radius + _Robot[j].radius){
+                npairs++;
+            }
+        }
+    }
+    return npairs;
+}
+int CollisionUR::MoveJ_Test(const tJoints &j1, const tJoints &j2, double minstep_deg) const{
+    if (minstep_deg <= 0){
+        minstep_deg = 2.0;
+    }
+    double span = 0;
+    for (int i=0; i<6 && i<j1.Length() && i<j2.Length(); i++){
+        span = qMax(span, fabs(j2.ValuesD()[i] - j1.ValuesD()[i]));
+    }
+    int nsteps = qMax(1, (int)ceil(span / minstep_deg));
+    double joints[6] = {0, 0, 0, 0, 0, 0};
+    for (int s=0; s<=nsteps; s++){
+        double t = (double)s / nsteps;
+        for (int i=0; i<6 && i<j1.Length() && i<j2.Length(); i++){
+            joints[i] = j1.ValuesD()[i] + t*(j2.ValuesD()[i] - j1.ValuesD()[i]);
+        }
+        int npairs = Collisions(tJoints(joints, 6));
+        if (npairs > 0){
+            return npairs;
+        }
+    }
+    return 0;
+}
+int CollisionUR::MoveL_Test(const tJoints &j1, const Mat &pose2, double minstep_mm) const{
+    if (minstep_mm <= 0){
+        minstep_mm = 5.0;
+    }
+    Mat pose1 = _Kinematics.SolveFK(j1);
+    // straight line for the position, constant rotation speed about one axis for the orientation
+    double dist2 = 0;
+    for (int i=0; i<3; i++){
+        double d = pose2.Get(i,3) - pose1.Get(i,3);
+        dist2 += d*d;
+    }
+    double rel[9];
+    for (int r=0; r<3; r++){
+        for (int c=0; c<3; c++){
+            rel[r*3+c] = pose1.Get(0,r)*pose2.Get(0,c) + pose1.Get(1,r)*pose2.Get(1,c) + pose1.Get(2,r)*pose2.Get(2,c);
+        }
+    }
+    double angle = acos(qBound(-1.0, (rel[0] + rel[4] + rel[8] - 1) * 0.5, 1.0));
+    double axis[3] = {rel[7] - rel[5], rel[2] - rel[6], rel[3] - rel[1]};
+    if (angle > M_PI_2){
+        // the skew part vanishes near a half turn: take the axis from the symmetric part, (R+R')/2 = cos*I + (1-cos)*a*a'
+        double ca = cos(angle);
+        double aa[9];
+        for (int r=0; r<3; r++){
+            for (int c=0; c<3; c++){
+                aa[r*3+c] = ((rel[r*3+c] + rel[c*3+r]) * 0.5 - (r == c ? ca : 0)) / (1 - ca);
+            }
+        }
+        int k = 0;
+        for (int i=1; i<3; i++){
+            if (aa[i*4] > aa[k*4]){
+                k = i;
+            }
+        }
+        if (!(aa[k*4] > 0)){
+            return -1; // the orientation cannot be followed
+        }
+        // column k is a*a[k]; the sign comes from the skew part, at a half turn either one will do
+        double sign = aa[0*3+k]*axis[0] + aa[1*3+k]*axis[1] + aa[2*3+k]*axis[2] < 0 ? -1 : 1;
+        for (int i=0; i<3; i++){
+            axis[i] = sign * aa[i*3+k];
+        }
+    }
+    double axis_norm = sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+    if (axis_norm < 1e-9){
+        angle = 0; // no rotation
+    } else {
+        for (int i=0; i<3; i++){
+            axis[i] /= axis_norm;
+        }
+    }
+    int nsteps = qMax(1, (int)ceil(qMax(sqrt(dist2) / minstep_mm, angle * 180.0 / M_PI / 2.0)));
+
+    tJoints joints(j1);
+    int npairs = Collisions(joints);
+    if (npairs > 0){
+        return npairs;
+    }
+    for (int s=1; s<=nsteps; s++){
+        double t = (double)s / nsteps;
+        double ct = cos(angle*t), st = sin(angle*t), vt = 1 - ct;
+        double step[9] = {
+            ct + axis[0]*axis[0]*vt,         axis[0]*axis[1]*vt - axis[2]*st, axis[0]*axis[2]*vt + axis[1]*st,
+            axis[1]*axis[0]*vt + axis[2]*st, ct + axis[1]*axis[1]*vt,         axis[1]*axis[2]*vt - axis[0]*st,
+            axis[2]*axis[0]*vt - axis[1]*st, axis[2]*axis[1]*vt + axis[0]*st, ct + axis[2]*axis[2]*vt
+        };
+        Mat pose;
+        for (int r=0; r<3; r++){
+            for (int c=0; c<3; c++){
+                pose.Set(r, c, pose1.Get(r,0)*step[c] + pose1.Get(r,1)*step[3+c] + pose1.Get(r,2)*step[6+c]);
+            }
+            pose.Set(r, 3, pose1.Get(r,3) + t*(pose2.Get(r,3) - pose1.Get(r,3)));
+        }
+        // follow the branch of the previous step, a jump means a singularity or a limit
+        tJoints next;
+        if (!_Kinematics.SolveIK(pose, joints, next)){
+            return -1;
+        }
+        for (int i=0; i<6; i++){
+            if (fabs(next.ValuesD()[i] - joints.ValuesD()[i]) > 30.0){
+                return -1;
+            }
+        }
+        joints = next;
+        npairs = Collisions(joints);
+        if (npairs > 0){
+            return npairs;
+        }
+    }
+    return 0;
+}
+
 //---------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------
@@ -865,6 +1457,10 @@ void Item::setPoseFrame(Mat frame_pose){
     _RDK->_send_Pose(frame_pose);
     _RDK->_send_Item(this);
     _RDK->_check_status();
+    QHash<quint64, RoboDK::tFrameTool>::iterator frame_tool = _RDK->_FRAME_TOOL.find(_PTR);
+    if (frame_tool != _RDK->_FRAME_TOOL.end()){
+        frame_tool.value().frame = frame_pose;
+    }
 }
 
 /// <summary>
@@ -878,6 +1474,9 @@ void Item::setPoseFrame(Item frame_item){
     _RDK->_send_Item(frame_item);
     _RDK->_send_Item(this);
     _RDK->_check_status();
+    if (_RDK->_FRAME_TOOL.contains(_PTR)){
+        _RDK->_FRAME_TOOL[_PTR].frame = PoseFrame();
+    }
 }
 
 /// <summary>
@@ -891,6 +1490,10 @@ void Item::setPoseTool(Mat tool_pose){
     _RDK->_send_Pose(tool_pose);
     _RDK->_send_Item(this);
     _RDK->_check_status();
+    QHash<quint64, RoboDK::tFrameTool>::iterator frame_tool = _RDK->_FRAME_TOOL.find(_PTR);
+    if (frame_tool != _RDK->_FRAME_TOOL.end()){
+        frame_tool.value().tool_inv = tool_pose.inv();
+    }
 }
 
 /// <summary>
@@ -904,6 +1507,9 @@ void Item::setPoseTool(Item tool_item){
     _RDK->_send_Item(tool_item);
     _RDK->_send_Item(this);
     _RDK->_check_status();
+    if (_RDK->_FRAME_TOOL.contains(_PTR)){
+        _RDK->_FRAME_TOOL[_PTR].tool_inv = PoseTool().inv();
+    }
 }
 
 /// <summary>
@@ -1177,11 +1783,18 @@ Item Item::AddTool(const Mat &tool_pose, const QString &tool_name){
 /// <param name="joints"></param>
 /// <returns>4x4 homogeneous matrix: pose of the robot flange with respect to the robot base</returns>
 Mat Item::SolveFK(const tJoints &joints, const Mat *tool, const Mat *ref){
-    _RDK->_check_connection();
-    _RDK->_send_Line("G_FK");
-    _RDK->_send_Array(&joints);
-    _RDK->_send_Item(this);
-    Mat pose = _RDK->_recv_Pose();
+    Mat pose;
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin != _RDK->_KINEMATICS.constEnd()){
+        pose = kin->SolveFK(joints);
+    } else {
+        _RDK->_check_connection();
+        _RDK->_send_Line("G_FK");
+        _RDK->_send_Array(&joints);
+        _RDK->_send_Item(this);
+        pose = _RDK->_recv_Pose();
+        _RDK->_check_status();
+    }
     Mat base2flange(pose);
     if (tool != nullptr){
         base2flange = pose*(*tool);
@@ -1189,7 +1802,6 @@ Mat Item::SolveFK(const tJoints &joints, const Mat *tool, const Mat *ref){
     if (ref != nullptr){
         base2flange = ref->inv() * base2flange;
     }
-    _RDK->_check_status();
     return base2flange;
 }
 
@@ -1204,13 +1816,14 @@ void Item::JointsConfig(const tJoints &joints, tConfig config){
     _RDK->_send_Array(&joints);
     _RDK->_send_Item(this);
     int sz = RDK_SIZE_MAX_CONFIG;
-    _RDK->_recv_Array(config, &sz);
+    _RDK->_recv_Array(config, RDK_SIZE_MAX_CONFIG, &sz);
     _RDK->_check_status();
     //return config;
 }
 
 /// <summary>
 /// Computes the inverse kinematics for the specified robot and pose. The joints returned are the closest to the current robot configuration (see SolveIK_All())
+/// The current joints are read from RoboDK, so this takes a round trip even with a local model (see setKinematicsUR). Pass joints_approx to the other overload to avoid it.
 /// </summary>
 /// <param name="pose">4x4 matrix -> pose of the robot flange with respect to the robot base frame</param>
 /// <param name="tool">4x4 matrix -> Optionally provide a tool, otherwise, the robot flange is used. Tip: use robot.PoseTool() to retrieve the active robot tool.</param>
@@ -1225,6 +1838,12 @@ tJoints Item::SolveIK(const Mat &pose, const Mat *tool, const Mat *ref){
     if (ref != nullptr){
         base2flange = (*ref) * base2flange;
     }
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin != _RDK->_KINEMATICS.constEnd()){
+        // closest to the current position, like RoboDK
+        kin->SolveIK(base2flange, Joints(), jnts);
+        return jnts;
+    }
     _RDK->_check_connection();
     _RDK->_send_Line("G_IK");
     _RDK->_send_Pose(base2flange);
@@ -1252,6 +1871,12 @@ tJoints Item::SolveIK(const Mat pose, tJoints joints_approx, const Mat *tool, co
     if (ref != nullptr){
         base2flange = (*ref) * base2flange;
     }
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin != _RDK->_KINEMATICS.constEnd()){
+        tJoints jnts;
+        kin->SolveIK(base2flange, joints_approx, jnts);
+        return jnts;
+    }
     _RDK->_check_connection();
     _RDK->_send_Line("G_IK_jnts");
     _RDK->_send_Pose(base2flange);
@@ -1278,6 +1903,21 @@ tMatrix2D* Item::SolveIK_All_Mat2D(const Mat &pose, const Mat *tool, const Mat *
     if (ref != nullptr){
         base2flange = (*ref) * base2flange;
     }
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin != _RDK->_KINEMATICS.constEnd()){
+        // same layout as RoboDK: one solution per column, two extra rows
+        tJoints solutions[8];
+        int nsol = kin->SolveIK_All(base2flange, solutions);
+        mat2d = Matrix2D_Create();
+        Matrix2D_Set_Size(mat2d, 8, nsol);
+        for (int s=0; s<nsol; s++){
+            double *column = Matrix2D_Get_col(mat2d, s);
+            memcpy(column, solutions[s].ValuesD(), 6*sizeof(double));
+            column[6] = 0;
+            column[7] = 0;
+        }
+        return mat2d;
+    }
     _RDK->_check_connection();
     _RDK->_send_Line("G_IK_cmpl");
     _RDK->_send_Pose(base2flange);
@@ -1299,6 +1939,136 @@ QList<tJoints> Item::SolveIK_All(const Mat &pose, const Mat *tool, const Mat *re
     return jnts_list;
 }
 
+/// <summary>
+/// Solves the kinematics of this robot in process with a UR model instead of asking RoboDK. SolveFK, SolveIK with joints_approx and SolveIK_All then need no round trip; SolveIK without joints_approx still reads the current joints from RoboDK.
+/// The joint limits and the base offset of the model are loaded from RoboDK once, and the model is checked against the robot's own forward kinematics.
+/// A collision model set with setCollisionUR is kept and uses the new model. If the model does not match, the collision model is dropped as well.
+/// </summary>
+/// <param name="model">UR model, for example KinematicsUR::UR3()</param>
+/// <returns>true if the model matches the robot. Otherwise RoboDK is still used.</returns>
+bool Item::setKinematicsUR(const KinematicsUR &model){
+    // the check below compares against RoboDK, not against a previous model
+    _RDK->_KINEMATICS.remove(_PTR);
+    KinematicsUR kin(model);
+    tJoints lower, upper;
+    JointLimits(&lower, &upper);
+    kin.setJointLimits(lower, upper);
+
+    // RoboDK may place the robot base away from the DH base: take the offset at the zero position
+    tJoints zero(6);
+    kin.setBase(SolveFK(zero) * kin.SolveFK(zero).inv());
+
+    // then check a few other positions, a wrong model or joint convention shows up here
+    const double check[3][6] = {{30, -60, 45, -90, 60, 15}, {-120, -100, -80, 40, -30, 90}, {75, -20, 110, -150, 120, -45}};
+    for (int i=0; i<3; i++){
+        tJoints joints(check[i], 6);
+        Mat remote = SolveFK(joints);
+        Mat local = kin.SolveFK(joints);
+        for (int r=0; r<3; r++){
+            for (int c=0; c<4; c++){
+                double tolerance = c == 3 ? 0.1 : 1e-4; // mm for the position
+                if (fabs(remote.Get(r,c) - local.Get(r,c)) > tolerance){
+                    clearKinematicsUR();
+                    return false;
+                }
+            }
+        }
+    }
+    _RDK->_KINEMATICS.insert(_PTR, kin);
+    QHash<quint64, CollisionUR>::iterator collision = _RDK->_COLLISION.find(_PTR);
+    if (collision != _RDK->_COLLISION.end()){
+        collision->setKinematics(kin);
+    }
+    return true;
+}
+
+/// <summary>
+/// Computes the inverse kinematics of many poses at once, for example to check which candidate cuts are reachable.
+/// With a local model (see setKinematicsUR) the poses are solved in process, otherwise the requests are sent to RoboDK together and the replies read afterwards.
+/// </summary>
+/// <param name="poses">poses of the robot tool with respect to the reference frame</param>
+/// <param name="results">one result per pose: joints, solution branch and feasibility</param>
+/// <param name="joints_approx">solutions closest to these joints are chosen. Leave empty to use the current robot position.</param>
+/// <param name="tool">Optionally provide a tool pose, otherwise, the robot flange is used.</param>
+/// <param name="ref">Optionally provide a reference pose, otherwise, the robot base is used.</param>
+/// <returns>number of feasible poses</returns>
+int Item::SolveIK_Batch(const QList<Mat> &poses, QList<tIKResult> &results, const tJoints *joints_approx, const Mat *tool, const Mat *ref){
+    tJoints approx = joints_approx != nullptr ? *joints_approx : Joints();
+    QVector<Mat> base2flange(poses.size());
+    Mat tool_inv = tool != nullptr ? tool->inv() : Mat();
+    for (int i=0; i<poses.size(); i++){
+        base2flange[i] = tool != nullptr ? Mat(poses[i]*tool_inv) : poses[i];
+        if (ref != nullptr){
+            base2flange[i] = (*ref) * base2flange[i];
+        }
+    }
+    QVector<tIKResult> solved(poses.size());
+    int nfeasible = 0;
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin != _RDK->_KINEMATICS.constEnd()){
+        nfeasible = kin->SolveIK_Batch(base2flange.constData(), base2flange.size(), approx, solved.data());
+    } else {
+        // all requests first, then the replies in the same order
+        _RDK->_check_connection();
+        for (int i=0; i<base2flange.size(); i++){
+            _RDK->_send_Line("G_IK_jnts");
+            _RDK->_send_Pose(base2flange[i]);
+            _RDK->_send_Array(&approx);
+            _RDK->_send_Item(this);
+        }
+        for (int i=0; i<base2flange.size(); i++){
+            tIKResult &result = solved[i];
+            _RDK->_recv_Array(&result.joints);
+            _RDK->_check_status();
+            result.branch = -1;
+            result.feasible = result.joints.Valid();
+            if (result.feasible){
+                nfeasible++;
+            }
+        }
+    }
+    results = solved.toList();
+    return nfeasible;
+}
+
+/// <summary>
+/// Goes back to solving the kinematics of this robot in RoboDK.
+/// </summary>
+void Item::clearKinematicsUR(){
+    _RDK->_KINEMATICS.remove(_PTR);
+    _RDK->_COLLISION.remove(_PTR);
+    _RDK->_FRAME_TOOL.remove(_PTR);
+}
+
+/// <summary>
+/// Checks the movements of this robot for collisions in process (MoveJ_Test and MoveL_Test) instead of asking RoboDK. Requires a local UR model (see setKinematicsUR); the calibrated model of the robot replaces the one in the collision model.
+/// The active reference frame and tool are read here once for MoveL_Test. setPoseFrame and setPoseTool on this item keep them up to date; if they are changed any other way, call setCollisionUR again.
+/// </summary>
+/// <param name="model">collision model, for example CollisionUR::UR3() with the table and the leg added</param>
+/// <returns>true if the model is used, false if the robot has no local kinematics</returns>
+bool Item::setCollisionUR(const CollisionUR &model){
+    QHash<quint64, KinematicsUR>::const_iterator kin = _RDK->_KINEMATICS.constFind(_PTR);
+    if (kin == _RDK->_KINEMATICS.constEnd()){
+        return false;
+    }
+    CollisionUR collision(model);
+    collision.setKinematics(*kin);
+    RoboDK::tFrameTool frame_tool;
+    frame_tool.frame = PoseFrame();
+    frame_tool.tool_inv = PoseTool().inv();
+    _RDK->_COLLISION.insert(_PTR, collision);
+    _RDK->_FRAME_TOOL.insert(_PTR, frame_tool);
+    return true;
+}
+
+/// <summary>
+/// Goes back to checking collisions in RoboDK.
+/// </summary>
+void Item::clearCollisionUR(){
+    _RDK->_COLLISION.remove(_PTR);
+    _RDK->_FRAME_TOOL.remove(_PTR);
+}
+
 /// <summary>
 /// Connect to a real robot using the robot driver.
 /// </summary>
@@ -1437,6 +2207,10 @@ void Item::MoveC(const Mat &target1, const Mat &target2, bool blocking){
 /// <param name="minstep_deg">(optional): maximum joint step in degrees</param>
 /// <returns>collision : returns 0 if the movement is free of collision. Otherwise it returns the number of pairs of objects that collided if there was a collision.</returns>
 int Item::MoveJ_Test(const tJoints &j1, const tJoints &j2, double minstep_deg){
+    QHash<quint64, CollisionUR>::const_iterator collision = _RDK->_COLLISION.constFind(_PTR);
+    if (collision != _RDK->_COLLISION.constEnd()){
+        return collision->MoveJ_Test(j1, j2, minstep_deg);
+    }
     _RDK->_check_connection();
     _RDK->_send_Line("CollisionMove");
     _RDK->_send_Item(this);
@@ -1458,6 +2232,13 @@ int Item::MoveJ_Test(const tJoints &j1, const tJoints &j2, double minstep_deg){
 /// <param name="minstep_mm">(optional): maximum joint step in degrees</param>
 /// <returns>collision : returns 0 if the movement is free of collision. Otherwise it returns the number of pairs of objects that collided if there was a collision.</returns>
 int Item::MoveL_Test(const tJoints &j1, const Mat &pose2, double minstep_deg){
+    QHash<quint64, CollisionUR>::const_iterator collision = _RDK->_COLLISION.constFind(_PTR);
+    if (collision != _RDK->_COLLISION.constEnd()){
+        // the model works with the flange in the robot base
+        const RoboDK::tFrameTool &frame_tool = _RDK->_FRAME_TOOL[_PTR];
+        Mat flange = frame_tool.frame * pose2 * frame_tool.tool_inv;
+        return collision->MoveL_Test(j1, flange, minstep_deg);
+    }
     _RDK->_check_connection();
     _RDK->_send_Line("CollisionMoveL");
     _RDK->_send_Item(this);
@@ -1899,7 +2680,7 @@ double Item::Update(int collision_check, int timeout_sec, double *out_nins_time_
     _RDK->_TIMEOUT = timeout_sec * 1000;
     double return_values[10];
     int nvalues = 10;
-    _RDK->_recv_Array(return_values, &nvalues);
+    _RDK->_recv_Array(return_values, 10, &nvalues);
     _RDK->_TIMEOUT = ROBODK_API_TIMEOUT;
     QString readable_msg = _RDK->_recv_Line();
     _RDK->_check_status();
@@ -1975,7 +2756,20 @@ quint64 Item::GetID(){
 //---------------------------------------------------------------------------------------------------
 /////////////////////////////////// RoboDK CLASS ////////////////////////////////////////////////////
 RoboDK::RoboDK(const QString &robodk_ip, int com_port, const QString &args, const QString &path) {
+    _init(robodk_ip, com_port, args, path);
+    _connect_smart();
+}
+
+RoboDK::RoboDK(const QString &robodk_ip, int com_port, tNoConnect) {
+    _init(robodk_ip, com_port, "", "");
+}
+
+void RoboDK::_init(const QString &robodk_ip, int com_port, const QString &args, const QString &path) {
     _COM = NULL;
+    _BATCH = false;
+    _NEW_COMMAND = true;
+    _BATCH_COUNT = 0;
+    _COMMAND_INDEX = 0;
     _IP = robodk_ip;
     _TIMEOUT = ROBODK_API_TIMEOUT;
     _PROCESS = 0;
@@ -1991,7 +2785,6 @@ RoboDK::RoboDK(const QString &robodk_ip, int com_port, const QString &args, cons
     if (com_port > 0){
         _ARGUMENTS.append(" /PORT=" + QString::number(com_port));
     }
-    _connect_smart();
 }
 
 RoboDK::~RoboDK(){
@@ -2037,6 +2830,34 @@ void RoboDK::Finish(){
     Disconnect();
 }
 
+/// <summary>
+/// Starts batch mode. Commands that only return a status are queued and sent together, without waiting for a reply after each one.
+/// </summary>
+void RoboDK::BatchStart(){
+    _collect_Batch();
+    _BATCH = true;
+    _BATCH_COUNT = 0;
+    _BATCH_ERRORS.clear();
+}
+/// <summary>
+/// Ends batch mode. Sends the queued commands and collects their statuses.
+/// </summary>
+/// <param name="errors">optional list that receives the commands that returned a warning or an error</param>
+/// <returns>number of commands that returned a warning or an error</returns>
+int RoboDK::BatchEnd(QList<tBatchStatus> *errors){
+    if (_COM != NULL){
+        _COM->flush();
+    }
+    _collect_Batch();
+    _BATCH = false;
+    int nerrors = _BATCH_ERRORS.size();
+    if (errors != NULL){
+        *errors = _BATCH_ERRORS;
+    }
+    _BATCH_ERRORS.clear();
+    return nerrors;
+}
+
 // %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 // public methods
 /// <summary>
@@ -2347,6 +3168,26 @@ Item RoboDK::AddPoints(Mat *points, Item *referenceObject, bool addToRef, int Pr
     _check_status();
     return newitem;
 }
+/// <summary>
+/// Adds a list of points of any length to an object. The points are sent as one matrix, see CloudPublisher to keep a live cloud up to date.
+/// </summary>
+/// <param name="points">list of points as a matrix (3xN matrix, or 6xN to provide point normals as ijk vectors)</param>
+/// <param name="referenceObject">item to attach the newly added geometry (optional)</param>
+/// <param name="addToRef">If True, the points will be added as part of the object in the RoboDK item tree (a reference object must be provided)</param>
+/// <param name="projectionType">Type of projection.Use the PROJECTION_* flags.</param>
+/// <returns>added object/shape (0 if failed)</returns>
+Item RoboDK::AddPoints(tMatrix2D *points, Item *referenceObject, bool addToRef, int ProjectionType)
+{
+    _check_connection();
+    _send_Line("AddPoints");
+    _send_Matrix2D(points);
+    _send_Item(referenceObject);
+    _send_Int(addToRef? 1 : 0);
+    _send_Int(ProjectionType);
+    Item newitem = _recv_Item();
+    _check_status();
+    return newitem;
+}
 
 Mat RoboDK::ProjectPoints(Mat *points, Item objectProject, int ProjectionType)
 {
@@ -2847,12 +3688,12 @@ void RoboDK::CalibrateTool(tMatrix2D *poses_joints, tXYZ tcp_xyz, int format, in
     _send_Int(algorithm);
     _send_Item(robot);
     int nxyz = 3;
-    _recv_Array(tcp_xyz, &nxyz);
+    _recv_Array(tcp_xyz, 3, &nxyz);
     if (error_stats != NULL){
-        _recv_Array(error_stats);
+        _recv_Array(error_stats, 20);
     } else {
         double errors_ignored[20];
-        _recv_Array(errors_ignored);
+        _recv_Array(errors_ignored, 20);
     }
     tMatrix2D *error_graph = Matrix2D_Create();
     _recv_Matrix2D(&error_graph);
@@ -2877,7 +3718,7 @@ Mat RoboDK::CalibrateReference(tMatrix2D *poses_joints, int method, bool use_joi
     _send_Item(robot);
     Mat reference_pose = _recv_Pose();
     double error_stats[20];
-    _recv_Array(error_stats);
+    _recv_Array(error_stats, 20);
     _check_status();
     return reference_pose;
 }
@@ -3038,6 +3879,31 @@ Item RoboDK::Popup_ISO9283_CubeProgram(Item *robot, tXYZ center, double side, bo
 
 //-------------------------- private ---------------------------------------
 
+// Bulk codec for the binary messages. RoboDK expects the big endian layout
+// QDataStream writes, so whole arrays are swapped into one buffer and sent
+// with a single write instead of one stream operation per value.
+static char *_encode_Int(char *out, qint32 value){
+    qToBigEndian(value, reinterpret_cast<uchar *>(out));
+    return out + sizeof(qint32);
+}
+static char *_encode_Doubles(char *out, const double *values, int count){
+    quint64 bits;
+    for (int i=0; i<count; i++){
+        memcpy(&bits, values + i, sizeof(double));
+        qToBigEndian(bits, reinterpret_cast<uchar *>(out));
+        out += sizeof(double);
+    }
+    return out;
+}
+// Swaps doubles read as raw bytes into place
+static void _decode_Doubles(double *values, int count){
+    quint64 bits;
+    for (int i=0; i<count; i++){
+        bits = qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(values + i));
+        memcpy(values + i, &bits, sizeof(double));
+    }
+}
+
 bool RoboDK::_connected(){
     return _COM != NULL && _COM->state() == QTcpSocket::ConnectedState;
 }
@@ -3055,19 +3921,38 @@ bool RoboDK::_check_connection(){
 }
 
 bool RoboDK::_check_status(){
+    _NEW_COMMAND = true;
+    if (_BATCH){
+        // read later by _collect_Batch, the command does not wait for it
+        tPendingStatus pending;
+        pending.index = _COMMAND_INDEX;
+        pending.command = _COMMAND;
+        pending.timeout = _TIMEOUT;
+        _PENDING.append(pending);
+        return 0;
+    }
+    QString strproblems;
+    qint32 status = _recv_Status(strproblems);
+    if (status == 2) {
+        return 0; // warnings are only printed
+    }
+    return status;
+}
+
+qint32 RoboDK::_recv_Status(QString &strproblems){
     qint32 status = _recv_Int();
     if (status > 0 && status < 10) {
-        QString strproblems("Unknown error");
+        strproblems = "Unknown error";
         if (status == 1) {
             strproblems = "Invalid item provided: The item identifier provided is not valid or it does not exist.";
         } else if (status == 2) { //output warning only
             strproblems = _recv_Line();
             qDebug() << "RoboDK API WARNING: " << strproblems;
-            return 0;
         } else if (status == 3){ // output error
             strproblems = _recv_Line();
             qDebug() << "RoboDK API ERROR: " << strproblems;
         } else if (status == 9) {
+            strproblems = "Invalid RoboDK License";
             qDebug() << "Invalid RoboDK License";
         }
         //print(strproblems);
@@ -3077,14 +3962,38 @@ bool RoboDK::_check_status(){
         //status = status
     } else  {
         //throw new RDKException("Communication problems with the RoboDK API"); //raise Exception('Problems running function');
+        strproblems = "Communication problems with the RoboDK API";
         qDebug() << "Communication problems with the RoboDK API";
     }
     return status;
 }
 
+// Reads the statuses queued in batch mode. Replies come back in the order the
+// commands were sent, so this has to run before any other reply is read.
+void RoboDK::_collect_Batch(){
+    if (_PENDING.isEmpty()){
+        return;
+    }
+    QList<tPendingStatus> pending;
+    pending.swap(_PENDING); // the reads below must not collect again
+    int timeout = _TIMEOUT;
+    for (int i=0; i<pending.size(); i++){
+        _TIMEOUT = pending[i].timeout; // WaitMove replies only once the move is done
+        tBatchStatus result;
+        result.status = _recv_Status(result.message);
+        if (result.status != 0){
+            result.index = pending[i].index;
+            result.command = pending[i].command;
+            _BATCH_ERRORS.append(result);
+        }
+    }
+    _TIMEOUT = timeout;
+}
+
 
 
 void RoboDK::_disconnect(){
+    _PENDING.clear(); // their replies are lost with the socket
     if (_COM != NULL){
         _COM->deleteLater();
         _COM = NULL;
@@ -3170,6 +4079,7 @@ bool RoboDK::_connect(){
 
 /////////////////////////////////////////////
 bool RoboDK::_waitline(){
+    _collect_Batch();
     if (_COM == NULL){ return false; }
     while (!_COM->canReadLine()){
         if (!_COM->waitForReadyRead(_TIMEOUT)){
@@ -3193,6 +4103,13 @@ QString RoboDK::_recv_Line(){//QString &string){
 }
 bool RoboDK::_send_Line(const QString& string){
     if (_COM == NULL || !_COM->isOpen()){ return false; }
+    if (_NEW_COMMAND){
+        _COMMAND = string;
+        _NEW_COMMAND = false;
+        if (_BATCH){
+            _COMMAND_INDEX = _BATCH_COUNT++;
+        }
+    }
     _COM->write(string.toUtf8());
     _COM->write(ROBODK_API_LF, 1);
     return true;
@@ -3200,6 +4117,7 @@ bool RoboDK::_send_Line(const QString& string){
 
 int RoboDK::_recv_Int(){//qint32 &value){
     qint32 value; // do not change type
+    _collect_Batch();
     if (_COM == NULL){ return false; }
     if (_COM->bytesAvailable() < sizeof(qint32)){
         _COM->waitForReadyRead(_TIMEOUT);
@@ -3220,6 +4138,7 @@ bool RoboDK::_send_Int(qint32 value){
 
 Item RoboDK::_recv_Item(){//Item *item){
     Item item(this);
+    _collect_Batch();
     if (_COM == NULL){ return item; }
     item._PTR = 0;
     item._TYPE = -1;
@@ -3248,76 +4167,74 @@ bool RoboDK::_send_Item(const Item &item){
     return _send_Item(&item);
 }
 
+// Reads size bytes into data as they arrive. The timeout applies to each
+// chunk, not to the whole payload, so large transfers do not fail.
+bool RoboDK::_recv_Bytes(char *data, qint64 size){
+    _collect_Batch();
+    if (_COM == NULL){ return false; }
+    qint64 received = 0;
+    while (received < size){
+        if (_COM->bytesAvailable() <= 0 && !_COM->waitForReadyRead(_TIMEOUT)){
+            return false;
+        }
+        qint64 nread = _COM->read(data + received, size - received);
+        if (nread < 0){ return false; }
+        received += nread;
+    }
+    return true;
+}
+// Drops size bytes, to stay in sync after a message that did not fit
+bool RoboDK::_skip_Bytes(qint64 size){
+    char chunk[4096];
+    while (size > 0){
+        qint64 nread = qMin<qint64>(size, sizeof(chunk));
+        if (!_recv_Bytes(chunk, nread)){ return false; }
+        size -= nread;
+    }
+    return true;
+}
+
 Mat RoboDK::_recv_Pose(){//Mat &pose){
     Mat pose;
-    if (_COM == NULL){ return pose; }
-    int size = 16*sizeof(double);
-    if (_COM->bytesAvailable() < size){
-        _COM->waitForReadyRead(_TIMEOUT);
-        if (_COM->bytesAvailable() < size){
-            return pose;
-        }
+    double m44[16];
+    if (!_recv_Bytes(reinterpret_cast<char *>(m44), sizeof(m44))){
+        return pose;
     }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;
+    _decode_Doubles(m44, 16);
     for (int j=0; j<4; j++){
         for (int i=0; i<4; i++){
-            ds >> valuei;
-            pose.Set(i,j,valuei);
-            //pose.data()[i][j] = valuei;
+            pose.Set(i,j,m44[j*4+i]);
         }
     }
     return pose;
 }
 bool RoboDK::_send_Pose(const Mat &pose){
     if (_COM == NULL || !_COM->isOpen()){ return false; }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;    
+    double m44[16];
     for (int j=0; j<4; j++){
         for (int i=0; i<4; i++){
-            valuei = pose.Get(i,j);
-            ds << valuei;
+            m44[j*4+i] = pose.Get(i,j);
         }
     }
-    return true;
+    _BUFFER.resize(16*sizeof(double));
+    _encode_Doubles(_BUFFER.data(), m44, 16);
+    return _COM->write(_BUFFER) == _BUFFER.size();
 }
 bool RoboDK::_recv_XYZ(tXYZ pos){
-    if (_COM == NULL){ return false; }
-    int size = 3*sizeof(double);
-    if (_COM->bytesAvailable() < size){
-        _COM->waitForReadyRead(_TIMEOUT);
-        if (_COM->bytesAvailable() < size){
-            return false;
-        }
-    }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;
-    for (int i=0; i<3; i++){
-        ds >> valuei;
-        pos[i] = valuei;
+    if (!_recv_Bytes(reinterpret_cast<char *>(pos), 3*sizeof(double))){
+        return false;
     }
+    _decode_Doubles(pos, 3);
     return true;
 }
 bool RoboDK::_send_XYZ(const tXYZ pos){
     if (_COM == NULL || !_COM->isOpen()){ return false; }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;
-    for (int i=0; i<3; i++){
-        valuei = pos[i];
-        ds << valuei;
-    }
-    return true;
+    _BUFFER.resize(3*sizeof(double));
+    _encode_Doubles(_BUFFER.data(), pos, 3);
+    return _COM->write(_BUFFER) == _BUFFER.size();
 }
 bool RoboDK::_recv_Array(tJoints *jnts){
-    return _recv_Array(jnts->_Values, &(jnts->_nDOFs));
+    return _recv_Array(jnts->_Values, RDK_SIZE_JOINTS_MAX, &(jnts->_nDOFs));
 }
 bool RoboDK::_send_Array(const tJoints *jnts){
     if (jnts == NULL){
@@ -3337,42 +4254,31 @@ bool RoboDK::_send_Array(const Mat *mat){
     }
     return _send_Array(m44, 16);
 }
-bool RoboDK::_recv_Array(double *values, int *psize){
+// Receives an array of any length straight into values, which has room for
+// max_values. A longer array is cut to max_values and the rest is dropped.
+bool RoboDK::_recv_Array(double *values, int max_values, int *psize){
     int nvalues = _recv_Int();
     if (_COM == NULL || nvalues < 0) {return false;}
+    int nstore = qMin(nvalues, max_values);
     if (psize != NULL){
-        *psize = nvalues;
+        *psize = nstore;
     }
-    if (nvalues < 0 || nvalues > 50){return false;} //check if the value is not too big
-    int size = nvalues*sizeof(double);
-    if (_COM->bytesAvailable() < size){
-        _COM->waitForReadyRead(_TIMEOUT);
-        if (_COM->bytesAvailable() < size){
-            return false;
-        }
+    if (!_recv_Bytes(reinterpret_cast<char *>(values), (qint64)nstore*sizeof(double))){
+        return false;
     }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;
-    for (int i=0; i<nvalues; i++){
-        ds >> valuei;
-        values[i] = valuei;
+    _decode_Doubles(values, nstore);
+    if (nstore < nvalues){
+        _skip_Bytes((qint64)(nvalues - nstore)*sizeof(double));
+        return false;
     }
     return true;
 }
 bool RoboDK::_send_Array(const double *values, int nvalues){
     if (_COM == NULL || !_COM->isOpen()){ return false; }
-    if (!_send_Int((qint32)nvalues)){ return false; }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
-    double valuei;
-    for (int i=0; i<nvalues; i++){
-        valuei = values[i];
-        ds << valuei;
-    }
-    return true;
+    _BUFFER.resize(sizeof(qint32) + nvalues*sizeof(double));
+    char *out = _encode_Int(_BUFFER.data(), (qint32)nvalues);
+    _encode_Doubles(out, values, nvalues);
+    return _COM->write(_BUFFER) == _BUFFER.size();
 }
 bool RoboDK::_recv_Matrix2D(tMatrix2D **mat){ // needs to delete after!
     qint32 dim1 = _recv_Int();
@@ -3381,48 +4287,28 @@ bool RoboDK::_recv_Matrix2D(tMatrix2D **mat){ // needs to delete after!
     //emxInit_real_T(mat, 2);
     if (dim1 < 0 || dim2 < 0){ return false; }
     Matrix2D_Set_Size(*mat, dim1, dim2);
-    if (dim1*dim2 <= 0){
+    int count = dim1*dim2;
+    if (count <= 0){
         return true;
     }
-    QByteArray buffer;
-    int count = 0;
-    double value;
-    while (true){
-        int remaining = dim1*dim2 - count;
-        if (remaining <= 0){ return true; }
-        if (_COM->bytesAvailable() <= 0 && !_COM->waitForReadyRead(_TIMEOUT)){
-            Matrix2D_Delete(mat);
-            return false;
-        }
-        buffer = _COM->read(remaining*sizeof(double));
-        QDataStream indata(buffer);
-        indata.setFloatingPointPrecision(QDataStream::DoublePrecision);
-        while (!indata.atEnd()){
-            indata >> value;
-            (*mat)->data[count] = value;
-            count = count + 1;
-        }
+    // the values arrive column major, as tMatrix2D stores them: read them in place and swap once
+    if (!_recv_Bytes(reinterpret_cast<char *>((*mat)->data), (qint64)count*sizeof(double))){
+        Matrix2D_Delete(mat);
+        return false;
     }
-    return false;// we should never arrive here...
+    _decode_Doubles((*mat)->data, count);
+    return true;
 }
 bool RoboDK::_send_Matrix2D(tMatrix2D *mat){
     if (_COM == NULL || !_COM->isOpen()){ return false; }
-    QDataStream ds(_COM);
-    ds.setFloatingPointPrecision(QDataStream::DoublePrecision);
-    //ds.setByteOrder(QDataStream::LittleEndian);
     qint32 dim1 = Matrix2D_Size(mat, 1);
     qint32 dim2 = Matrix2D_Size(mat, 2);
-    bool ok1 = _send_Int(dim1);
-    bool ok2 = _send_Int(dim2);
-    if (!ok1 || !ok2) {return false; }
-    double valuei;
-    for (int j=0; j<dim2; j++){
-        for (int i=0; i<dim1; i++){
-            valuei = Matrix2D_Get_ij(mat, i, j);
-            ds << valuei;
-        }
-    }
-    return true;
+    // the data is column major, the order RoboDK reads it in
+    _BUFFER.resize(2*sizeof(qint32) + dim1*dim2*sizeof(double));
+    char *out = _encode_Int(_BUFFER.data(), dim1);
+    out = _encode_Int(out, dim2);
+    _encode_Doubles(out, mat->data, dim1*dim2);
+    return _COM->write(_BUFFER) == _BUFFER.size();
 }
 // private move type, to be used by public methods (MoveJ  and MoveL)
 void RoboDK::_moveX(const Item *target, const tJoints *joints, const Mat *mat_target, const Item *itemrobot, int movetype, bool blocking){
@@ -3509,6 +4395,274 @@ void RoboDK::_moveC(const Item *target1, const tJoints *joints1, const Mat *mat_
 
 
 
+//----------------------------------- Live cloud publisher ------------------------
+/// <summary>
+/// Creates a publisher that shows a point cloud in RoboDK as one object with the given name.
+/// </summary>
+/// <param name="rdk">RoboDK link</param>
+/// <param name="name">name of the object in the station tree</param>
+CloudPublisher::CloudPublisher(RoboDK *rdk, const QString &name){
+    _RDK = rdk;
+    _NAME = name;
+    _LEAF = 5.0;
+    _SCALE = 1.0;
+    _CHANGE = 0.05;
+    _MAX_POINTS = 20000;
+    _INTERVAL = 200;
+}
+void CloudPublisher::setLeafSize(double leaf_mm){
+    _LEAF = leaf_mm;
+}
+void CloudPublisher::setMaxPoints(int max_points){
+    _MAX_POINTS = max_points;
+}
+void CloudPublisher::setChangeThreshold(double fraction){
+    _CHANGE = fraction;
+}
+void CloudPublisher::setMinInterval(int msec){
+    _INTERVAL = msec;
+}
+void CloudPublisher::setScale(double scale){
+    _SCALE = scale;
+}
+void CloudPublisher::setParent(const Item &parent){
+    _PARENT = parent;
+}
+Item CloudPublisher::getItem() const{
+    return _ITEM;
+}
+/// <summary>
+/// Decimates the cloud and sends it to RoboDK if it changed enough since the last update.
+/// Calls within the minimum interval of the previous check return at once, so this can be called every frame.
+/// </summary>
+/// <param name="xyz">coordinates of the first point, the other points follow every stride floats (4 for a pcl::PointXYZ cloud)</param>
+/// <param name="count">number of points</param>
+/// <param name="stride">floats from one point to the next</param>
+/// <param name="force">send now, without the rate limit and the change threshold</param>
+/// <returns>true if the object in RoboDK was updated</returns>
+bool CloudPublisher::Publish(const float *xyz, int count, int stride, bool force){
+    if (!force && _TIMER.isValid() && _TIMER.elapsed() < _INTERVAL){
+        return false;
+    }
+    _TIMER.start();
+
+    // voxel centroids, keyed by the voxel coordinate (21 bits per axis)
+    const double inv_leaf = _LEAF > 0 ? 1.0 / _LEAF : 1.0;
+    const qint64 offset = qint64(1) << 20;
+    QHash<quint64, int> voxels;
+    voxels.reserve(qMin(count, 4*qMax(_MAX_POINTS, 1)));
+    QVector<double> sums;
+    QVector<int> counts;
+    std::vector<std::pair<quint64, int> > keys;
+    for (int i=0; i<count; i++){
+        const float *p = xyz + (qint64)i*stride;
+        if (!std::isfinite(p[0]) || !std::isfinite(p[1]) || !std::isfinite(p[2])){
+            continue;
+        }
+        double x = p[0]*_SCALE, y = p[1]*_SCALE, z = p[2]*_SCALE;
+        qint64 vx = (qint64)floor(x*inv_leaf) + offset;
+        qint64 vy = (qint64)floor(y*inv_leaf) + offset;
+        qint64 vz = (qint64)floor(z*inv_leaf) + offset;
+        if (vx < 0 || vy < 0 || vz < 0 || vx >= 2*offset || vy >= 2*offset || vz >= 2*offset){
+            continue;
+        }
+        quint64 key = ((quint64)vx << 42) | ((quint64)vy << 21) | (quint64)vz;
+        QHash<quint64, int>::iterator voxel = voxels.find(key);
+        if (voxel == voxels.end()){
+            voxel = voxels.insert(key, counts.size());
+            keys.push_back(std::make_pair(key, counts.size()));
+            sums << 0 << 0 << 0;
+            counts << 0;
+        }
+        sums[3*voxel.value()] += x;
+        sums[3*voxel.value()+1] += y;
+        sums[3*voxel.value()+2] += z;
+        counts[voxel.value()]++;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // share of voxels that appeared or disappeared since the last update
+    if (!force && _ITEM.Valid()){
+        int changed = 0;
+        size_t i = 0, j = 0;
+        while (i < keys.size() || j < (size_t)_SENT.size()){
+            if (j == (size_t)_SENT.size() || (i < keys.size() && keys[i].first < _SENT[j])){
+                changed++;
+                i++;
+            } else if (i == keys.size() || _SENT[j] < keys[i].first){
+                changed++;
+                j++;
+            } else {
+                i++;
+                j++;
+            }
+        }
+        if (changed <= _CHANGE * qMax((int)keys.size(), _SENT.size())){
+            return false;
+        }
+    }
+
+    // every n-th voxel if there are still too many
+    int step = 1;
+    if (_MAX_POINTS > 0 && (int)keys.size() > _MAX_POINTS){
+        step = ((int)keys.size() + _MAX_POINTS - 1) / _MAX_POINTS;
+    }
+    int npoints = ((int)keys.size() + step - 1) / step;
+    tMatrix2D *points = Matrix2D_Create();
+    Matrix2D_Set_Size(points, 3, npoints);
+    for (int k=0; k<npoints; k++){
+        int voxel = keys[k*step].second;
+        for (int r=0; r<3; r++){
+            points->data[3*k+r] = sums[3*voxel+r] / counts[voxel];
+        }
+    }
+
+    // add the new object before removing the old one so the view is never empty
+    Item item = _RDK->AddPoints(points, NULL, false, RoboDK::PROJECTION_NONE);
+    Matrix2D_Delete(&points);
+    if (!item.Valid()){
+        return false;
+    }
+    item.setName(_NAME);
+    if (_PARENT.Valid()){
+        item.setParent(_PARENT);
+    }
+    if (_ITEM.Valid()){
+        _ITEM.Delete();
+    }
+    _ITEM = item;
+    _SENT.resize((int)keys.size());
+    for (size_t k=0; k<keys.size(); k++){
+        _SENT[(int)k] = keys[k].first;
+    }
+    return true;
+}
+/// <summary>
+/// Removes the object from RoboDK. The next call to Publish creates it again.
+/// </summary>
+void CloudPublisher::Clear(){
+    if (_ITEM.Valid()){
+        _ITEM.Delete();
+    }
+    _ITEM = Item();
+    _SENT.clear();
+    _TIMER.invalidate();
+}
+
+
+
+
+//----------------------------------- Connection pool ------------------------
+/// <summary>
+/// Creates a pool of up to max_connections links to the same RoboDK instance. The links are opened by the threads that use them.
+/// </summary>
+/// <param name="max_connections">maximum number of links open at the same time</param>
+/// <param name="robodk_ip">IP of the computer running RoboDK (same as RoboDK)</param>
+/// <param name="com_port">port of the RoboDK API (same as RoboDK)</param>
+RoboDKPool::RoboDKPool(int max_connections, const QString &robodk_ip, int com_port){
+    _MAX = qMax(1, max_connections);
+    _IP = robodk_ip;
+    _PORT = com_port;
+}
+/// <summary>
+/// Closes the links still open. Release them from their threads first where possible: a socket should be closed by the thread that opened it.
+/// </summary>
+RoboDKPool::~RoboDKPool(){
+    QList<RoboDK*> sessions = _SESSIONS.values();
+    _SESSIONS.clear();
+    for (int i=0; i<sessions.size(); i++){
+        delete sessions[i];
+    }
+}
+/// <summary>
+/// Returns the link of the calling thread, opening it on first use. If max_connections links are already open by other threads, waits until one of them calls Release.
+/// The link must only be used by this thread. The pool only connects to a running RoboDK, it never starts one.
+/// </summary>
+/// <returns>RoboDK link of the calling thread, NULL if it could not be opened or was lost (the slot is freed, a later call tries again)</returns>
+RoboDK *RoboDKPool::Session(){
+    Qt::HANDLE thread = QThread::currentThreadId();
+    _MUTEX.lock();
+    QHash<Qt::HANDLE, RoboDK*>::const_iterator session = _SESSIONS.constFind(thread);
+    if (session != _SESSIONS.constEnd()){
+        RoboDK *rdk = session.value();
+        _MUTEX.unlock();
+        if (rdk->_connected() || rdk->_connect()){
+            return rdk;
+        }
+        return _drop(thread, rdk);
+    }
+    while (_SESSIONS.size() >= _MAX){
+        _FREE.wait(&_MUTEX);
+    }
+    // hold the slot while connecting, other threads can connect at the same time
+    _SESSIONS.insert(thread, NULL);
+    _MUTEX.unlock();
+
+    RoboDK *rdk = new RoboDK(_IP, _PORT, RoboDK::NO_CONNECT);
+    if (!rdk->_connect()){
+        return _drop(thread, rdk);
+    }
+
+    _MUTEX.lock();
+    _SESSIONS.insert(thread, rdk);
+    _MUTEX.unlock();
+    return rdk;
+}
+// frees the slot of a link that could not connect and lets a waiting thread have it
+RoboDK *RoboDKPool::_drop(Qt::HANDLE thread, RoboDK *rdk){
+    _MUTEX.lock();
+    _SESSIONS.remove(thread);
+    _MUTEX.unlock();
+    delete rdk;
+    _FREE.wakeOne();
+    return NULL;
+}
+/// <summary>
+/// Returns the same item on the link of the calling thread, so its methods can be called from this thread.
+/// The local kinematics and collision models of the item (see Item::setKinematicsUR and Item::setCollisionUR) are carried over. Set them before the workers start.
+/// </summary>
+/// <param name="item">item from any link to the same RoboDK instance</param>
+/// <returns>item using the link of the calling thread, invalid if the link could not be opened</returns>
+Item RoboDKPool::Route(const Item &item){
+    RoboDK *rdk = Session();
+    if (rdk == NULL){
+        return Item();
+    }
+    RoboDK *origin = item._RDK;
+    if (origin != NULL && origin != rdk){
+        QHash<quint64, KinematicsUR>::const_iterator kin = origin->_KINEMATICS.constFind(item._PTR);
+        if (kin != origin->_KINEMATICS.constEnd() && !rdk->_KINEMATICS.contains(item._PTR)){
+            rdk->_KINEMATICS.insert(item._PTR, kin.value());
+        }
+        QHash<quint64, CollisionUR>::const_iterator collision = origin->_COLLISION.constFind(item._PTR);
+        if (collision != origin->_COLLISION.constEnd() && !rdk->_COLLISION.contains(item._PTR)){
+            rdk->_COLLISION.insert(item._PTR, collision.value());
+            rdk->_FRAME_TOOL.insert(item._PTR, origin->_FRAME_TOOL.value(item._PTR));
+        }
+    }
+    return Item(rdk, item._PTR, item._TYPE);
+}
+/// <summary>
+/// Closes the link of the calling thread and lets a waiting thread open one. Items routed to it can no longer be used.
+/// </summary>
+void RoboDKPool::Release(){
+    _MUTEX.lock();
+    RoboDK *rdk = _SESSIONS.take(QThread::currentThreadId());
+    _MUTEX.unlock();
+    delete rdk;
+    _FREE.wakeOne();
+}
+/// <summary>
+/// Number of links open.
+/// </summary>
+int RoboDKPool::Size(){
+    QMutexLocker lock(&_MUTEX);
+    return _SESSIONS.size();
+}
+
+
+
+
 //---------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------
 //---------------------------------------------------------------------------------------------------
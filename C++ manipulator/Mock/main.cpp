@@ -0,0 +1,21 @@
+#include "mock_robodk.h"
+#include <QCoreApplication>
+
+// Mock RoboDK server: mock_robodk [port] [program steps]
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+    quint16 port = args.size() > 1 ? args[1].toUShort() : 20500;
+
+    MockRoboDK mock;
+    if (args.size() > 2){
+        mock.setProgramSteps(args[2].toInt());
+    }
+    if (!mock.Start(port)){
+        return 1;
+    }
+    qDebug() << "Mock RoboDK listening on port" << mock.Port();
+
+    return a.exec();
+}
@@ -0,0 +1,498 @@
+#include "mock_robodk.h"
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QtCore/QtEndian>
+#include <QtCore/QDateTime>
+#include <cstring>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MOCK_ROBOT 1
+#define MOCK_PROGRAM 2
+#define MOCK_TIMEOUT 100 // msec between checks for Stop while waiting for data
+
+/// Accepts the connections for MockRoboDK. It lives in the listener thread and
+/// hands each socket descriptor over, the socket is created by the thread serving it.
+class MockListener : public QTcpServer {
+public:
+    MockListener(MockRoboDK *mock){
+        _MOCK = mock;
+    }
+
+protected:
+    void incomingConnection(qintptr socket){
+        _MOCK->_accept(socket);
+    }
+
+private:
+    MockRoboDK *_MOCK;
+};
+
+MockRoboDK::MockRoboDK(const KinematicsUR &kinematics){
+    _KINEMATICS = kinematics;
+    _COLLISION = CollisionUR::UR3(kinematics);
+    const tXYZ up = {0, 0, 1};
+    _COLLISION.addObstaclePlane(up, 0); // table top at the robot base
+
+    tMockItem robot = {"UR3", RoboDK::ITEM_TYPE_ROBOT};
+    tMockItem program = {"Prog", RoboDK::ITEM_TYPE_PROGRAM};
+    _ITEMS.insert(MOCK_ROBOT, robot);
+    _ITEMS.insert(MOCK_PROGRAM, program);
+    _NEXT_ITEM = 100;
+    const double home[6] = {0, -90, 90, -90, -90, 0};
+    _JOINTS = tJoints(home, 6);
+
+    _STOP = true;
+    _PORT = 0;
+    _COMMANDS = 0;
+    _PROGRAM_STEPS = 10000;
+    _build_Program();
+}
+MockRoboDK::~MockRoboDK(){
+    Stop();
+}
+/// <summary>
+/// Number of points in the canned program joint list. Set it before Start.
+/// </summary>
+void MockRoboDK::setProgramSteps(int nsteps){
+    _PROGRAM_STEPS = qMax(1, nsteps);
+    _build_Program();
+}
+bool MockRoboDK::Start(quint16 port){
+    Stop();
+    _STOP = false;
+    std::promise<quint16> listening;
+    std::future<quint16> ready = listening.get_future();
+    _LISTENER = std::thread(&MockRoboDK::_serve, this, port, &listening);
+    _PORT = ready.get();
+    if (_PORT == 0){
+        _STOP = true;
+        _LISTENER.join();
+        return false;
+    }
+    return true;
+}
+void MockRoboDK::Stop(){
+    _STOP = true;
+    if (_LISTENER.joinable()){
+        _LISTENER.join();
+    }
+    // no new connections from here on
+    for (size_t i=0; i<_THREADS.size(); i++){
+        _THREADS[i].join();
+    }
+    _THREADS.clear();
+    _PORT = 0;
+}
+quint16 MockRoboDK::Port() const{
+    return _PORT;
+}
+qint64 MockRoboDK::Commands() const{
+    return _COMMANDS;
+}
+
+void MockRoboDK::_serve(quint16 port, std::promise<quint16> *listening){
+    MockListener server(this);
+    if (!server.listen(QHostAddress::LocalHost, port)){
+        qDebug() << "Mock RoboDK: cannot listen on port" << port << server.errorString();
+        listening->set_value(0);
+        return;
+    }
+    listening->set_value(server.serverPort());
+    while (!_STOP){
+        server.waitForNewConnection(MOCK_TIMEOUT);
+    }
+    server.close();
+}
+void MockRoboDK::_accept(qintptr socket){
+    QMutexLocker lock(&_THREADS_MUTEX);
+    _THREADS.push_back(std::thread(&MockRoboDK::_session, this, socket));
+}
+void MockRoboDK::_session(qintptr socket){
+    QTcpSocket com;
+    if (!com.setSocketDescriptor(socket)){
+        return;
+    }
+    com.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    tSession s;
+    s.com = &com;
+
+    // the client opens with the start string and the protocol version
+    QString start, version;
+    if (!_read_Line(s, start) || !_read_Line(s, version) || start != "CMD_START"){
+        return;
+    }
+    com.write("READY\n");
+    com.flush();
+
+    QString command;
+    while (_read_Line(s, command)){
+        s.out.clear();
+        if (!_command(s, command)){
+            qDebug() << "Mock RoboDK: unsupported command" << command << ", closing the connection";
+            break;
+        }
+        // one write per reply, as RoboDK does
+        com.write(s.out);
+        com.flush();
+        _COMMANDS++;
+    }
+    com.disconnectFromHost();
+}
+
+bool MockRoboDK::_command(tSession &s, const QString &command){
+    if (command == "G_Item" || command == "G_Item2"){
+        QString name;
+        qint32 type = -1;
+        if (!_read_Line(s, name)){ return false; }
+        if (command == "G_Item2" && !_read_Int(s, type)){ return false; }
+        quint64 found = 0;
+        QMutexLocker lock(&_MUTEX);
+        for (QHash<quint64, tMockItem>::const_iterator it = _ITEMS.constBegin(); it != _ITEMS.constEnd(); ++it){
+            if ((name.isEmpty() || it->name.compare(name, Qt::CaseInsensitive) == 0) && (type < 0 || it->type == type)){
+                found = it.key();
+                break;
+            }
+        }
+        lock.unlock();
+        _write_Item(s, found);
+        _write_Status(s);
+
+    } else if (command == "Version"){
+        _write_Line(s, "RoboDK");
+        _write_Int(s, 64);
+        _write_Line(s, "5.0.0 (mock)");
+        _write_Line(s, QDateTime::currentDateTime().toString("yyyy-MM-dd"));
+        _write_Status(s);
+
+    } else if (command == "G_Name"){
+        quint64 item;
+        if (!_read_Item(s, item)){ return false; }
+        QMutexLocker lock(&_MUTEX);
+        QString name = _ITEMS.value(item).name;
+        lock.unlock();
+        _write_Line(s, name);
+        _write_Status(s, name.isEmpty() ? 1 : 0);
+
+    } else if (command == "S_Name"){
+        quint64 item;
+        QString name;
+        if (!_read_Item(s, item) || !_read_Line(s, name)){ return false; }
+        QMutexLocker lock(&_MUTEX);
+        bool valid = _ITEMS.contains(item);
+        if (valid){
+            _ITEMS[item].name = name;
+        }
+        lock.unlock();
+        _write_Status(s, valid ? 0 : 1);
+
+    } else if (command == "S_Parent"){
+        quint64 item, parent;
+        if (!_read_Item(s, item) || !_read_Item(s, parent)){ return false; }
+        _write_Status(s);
+
+    } else if (command == "Remove"){
+        quint64 item;
+        if (!_read_Item(s, item)){ return false; }
+        QMutexLocker lock(&_MUTEX);
+        bool valid = item != MOCK_ROBOT && item != MOCK_PROGRAM && _ITEMS.remove(item) > 0;
+        lock.unlock();
+        _write_Status(s, valid ? 0 : 1);
+
+    } else if (command == "G_Thetas"){
+        quint64 item;
+        if (!_read_Item(s, item)){ return false; }
+        tJoints joints = _joints();
+        _write_Array(s, joints.ValuesD(), joints.Length());
+        _write_Status(s);
+
+    } else if (command == "S_Thetas"){
+        QVector<double> values;
+        quint64 item;
+        if (!_read_Array(s, values) || !_read_Item(s, item)){ return false; }
+        QMutexLocker lock(&_MUTEX);
+        _JOINTS = tJoints(values.constData(), qMin(values.size(), 6));
+        lock.unlock();
+        _write_Status(s);
+
+    } else if (command == "G_RobLimits"){
+        quint64 item;
+        if (!_read_Item(s, item)){ return false; }
+        const double lower[6] = {-360, -360, -360, -360, -360, -360};
+        const double upper[6] = {360, 360, 360, 360, 360, 360};
+        _write_Array(s, lower, 6);
+        _write_Array(s, upper, 6);
+        _write_Int(s, 0); // rotative joints
+        _write_Status(s);
+
+    } else if (command == "G_FK"){
+        QVector<double> values;
+        quint64 item;
+        if (!_read_Array(s, values) || !_read_Item(s, item)){ return false; }
+        _write_Pose(s, _KINEMATICS.SolveFK(tJoints(values.constData(), qMin(values.size(), 6))));
+        _write_Status(s);
+
+    } else if (command == "G_IK" || command == "G_IK_jnts"){
+        Mat pose;
+        QVector<double> approx;
+        quint64 item;
+        if (!_read_Pose(s, pose)){ return false; }
+        if (command == "G_IK_jnts" && !_read_Array(s, approx)){ return false; }
+        if (!_read_Item(s, item)){ return false; }
+        tJoints near = command == "G_IK_jnts" ? tJoints(approx.constData(), qMin(approx.size(), 6)) : _joints();
+        tJoints joints;
+        if (!_KINEMATICS.SolveIK(pose, near, joints)){
+            joints = tJoints(); // no solution: empty array
+        }
+        _write_Array(s, joints.ValuesD(), joints.Length());
+        _write_Status(s);
+
+    } else if (command == "G_IK_cmpl"){
+        Mat pose;
+        quint64 item;
+        if (!_read_Pose(s, pose) || !_read_Item(s, item)){ return false; }
+        tJoints solutions[8];
+        int nsol = _KINEMATICS.SolveIK_All(pose, solutions);
+        // one column per solution: the joints and 2 more values, like RoboDK
+        QVector<double> values(8*nsol, 0.0);
+        for (int i=0; i<nsol; i++){
+            memcpy(values.data() + 8*i, solutions[i].ValuesD(), 6*sizeof(double));
+        }
+        _write_Matrix2D(s, 8, nsol, values.constData());
+        _write_Status(s);
+
+    } else if (command == "CollisionMove" || command == "CollisionMoveL"){
+        quint64 item;
+        QVector<double> j1, j2;
+        Mat pose2;
+        qint32 step;
+        if (!_read_Item(s, item) || !_read_Array(s, j1)){ return false; }
+        if (command == "CollisionMove" ? !_read_Array(s, j2) : !_read_Pose(s, pose2)){ return false; }
+        if (!_read_Int(s, step)){ return false; }
+        tJoints joints1(j1.constData(), qMin(j1.size(), 6));
+        int collision;
+        if (command == "CollisionMove"){
+            collision = _COLLISION.MoveJ_Test(joints1, tJoints(j2.constData(), qMin(j2.size(), 6)), step / 1000.0);
+        } else {
+            collision = _COLLISION.MoveL_Test(joints1, pose2, step / 1000.0);
+        }
+        _write_Int(s, collision);
+        _write_Status(s);
+
+    } else if (command == "MoveX"){
+        qint32 movetype, kind;
+        QVector<double> values;
+        quint64 target, robot;
+        if (!_read_Int(s, movetype) || !_read_Int(s, kind) || !_read_Array(s, values) || !_read_Item(s, target) || !_read_Item(s, robot)){
+            return false;
+        }
+        // the move is done at once: joints are set, poses solved from the current joints
+        int status = 0;
+        if (kind == 1){
+            QMutexLocker lock(&_MUTEX);
+            _JOINTS = tJoints(values.constData(), qMin(values.size(), 6));
+        } else if (kind == 2 && values.size() == 16){
+            Mat pose;
+            for (int c=0; c<4; c++){
+                for (int r=0; r<4; r++){
+                    pose.Set(r, c, values[c*4+r]);
+                }
+            }
+            tJoints joints;
+            if (_KINEMATICS.SolveIK(pose, _joints(), joints)){
+                QMutexLocker lock(&_MUTEX);
+                _JOINTS = joints;
+            } else {
+                status = 3;
+            }
+        }
+        _write_Status(s, status);
+        if (status == 3){
+            _write_Line(s, "Target not reachable");
+        }
+
+    } else if (command == "WaitMove"){
+        quint64 item;
+        if (!_read_Item(s, item)){ return false; }
+        _write_Status(s); // command received
+        _write_Status(s); // move done
+
+    } else if (command == "AddPoints"){
+        qint32 rows, cols, add_to_ref, projection;
+        QVector<double> points;
+        quint64 reference;
+        if (!_read_Matrix2D(s, rows, cols, points) || !_read_Item(s, reference) || !_read_Int(s, add_to_ref) || !_read_Int(s, projection)){
+            return false;
+        }
+        tMockItem object = {"Points", RoboDK::ITEM_TYPE_OBJECT};
+        QMutexLocker lock(&_MUTEX);
+        quint64 item = _NEXT_ITEM++;
+        _ITEMS.insert(item, object);
+        lock.unlock();
+        _write_Item(s, item);
+        _write_Status(s);
+
+    } else if (command == "G_ProgJointList"){
+        quint64 item;
+        QVector<double> steps;
+        QString save_to_file;
+        if (!_read_Item(s, item) || !_read_Array(s, steps) || !_read_Line(s, save_to_file)){ return false; }
+        if (save_to_file.isEmpty()){
+            _write_Matrix2D(s, 10, _PROGRAM_STEPS, _PROGRAM.constData());
+        }
+        _write_Int(s, 0);
+        _write_Line(s, "");
+        _write_Status(s);
+
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Slow sweep of all the joints, with the error, step and move id rows RoboDK adds
+void MockRoboDK::_build_Program(){
+    _PROGRAM.resize(10*_PROGRAM_STEPS);
+    for (int i=0; i<_PROGRAM_STEPS; i++){
+        double t = (double)i / _PROGRAM_STEPS;
+        double *column = _PROGRAM.data() + 10*i;
+        for (int j=0; j<6; j++){
+            column[j] = 45.0 * sin(2*M_PI*t + j);
+        }
+        column[6] = 0;   // error
+        column[7] = 1.0; // mm step
+        column[8] = 1.0; // deg step
+        column[9] = i / 100; // move id
+    }
+}
+tJoints MockRoboDK::_joints(){
+    QMutexLocker lock(&_MUTEX);
+    return _JOINTS;
+}
+
+bool MockRoboDK::_read_Bytes(tSession &s, char *data, qint64 size){
+    qint64 received = 0;
+    while (received < size){
+        if (s.com->bytesAvailable() <= 0){
+            if (_STOP || s.com->state() != QAbstractSocket::ConnectedState){
+                return false;
+            }
+            s.com->waitForReadyRead(MOCK_TIMEOUT);
+            continue;
+        }
+        qint64 nread = s.com->read(data + received, size - received);
+        if (nread < 0){ return false; }
+        received += nread;
+    }
+    return true;
+}
+bool MockRoboDK::_read_Line(tSession &s, QString &line){
+    while (!s.com->canReadLine()){
+        if (_STOP || s.com->state() != QAbstractSocket::ConnectedState){
+            return false;
+        }
+        s.com->waitForReadyRead(MOCK_TIMEOUT);
+    }
+    line = QString::fromUtf8(s.com->readLine().trimmed());
+    return true;
+}
+bool MockRoboDK::_read_Int(tSession &s, qint32 &value){
+    uchar data[sizeof(qint32)];
+    if (!_read_Bytes(s, reinterpret_cast<char *>(data), sizeof(data))){ return false; }
+    value = qFromBigEndian<qint32>(data);
+    return true;
+}
+bool MockRoboDK::_read_Item(tSession &s, quint64 &ptr){
+    uchar data[sizeof(quint64)];
+    if (!_read_Bytes(s, reinterpret_cast<char *>(data), sizeof(data))){ return false; }
+    ptr = qFromBigEndian<quint64>(data);
+    return true;
+}
+// Swaps doubles read as raw bytes into place
+static void _decode_Doubles(double *values, int count){
+    for (int i=0; i<count; i++){
+        quint64 bits = qFromBigEndian<quint64>(reinterpret_cast<const uchar *>(values + i));
+        memcpy(values + i, &bits, sizeof(double));
+    }
+}
+bool MockRoboDK::_read_Array(tSession &s, QVector<double> &values){
+    qint32 nvalues;
+    if (!_read_Int(s, nvalues) || nvalues < 0){ return false; }
+    values.resize(nvalues);
+    if (!_read_Bytes(s, reinterpret_cast<char *>(values.data()), (qint64)nvalues*sizeof(double))){ return false; }
+    _decode_Doubles(values.data(), nvalues);
+    return true;
+}
+bool MockRoboDK::_read_Pose(tSession &s, Mat &pose){
+    double m44[16];
+    if (!_read_Bytes(s, reinterpret_cast<char *>(m44), sizeof(m44))){ return false; }
+    _decode_Doubles(m44, 16);
+    for (int c=0; c<4; c++){
+        for (int r=0; r<4; r++){
+            pose.Set(r, c, m44[c*4+r]);
+        }
+    }
+    return true;
+}
+bool MockRoboDK::_read_Matrix2D(tSession &s, qint32 &rows, qint32 &cols, QVector<double> &values){
+    if (!_read_Int(s, rows) || !_read_Int(s, cols) || rows < 0 || cols < 0){ return false; }
+    values.resize(rows*cols);
+    if (!_read_Bytes(s, reinterpret_cast<char *>(values.data()), (qint64)values.size()*sizeof(double))){ return false; }
+    _decode_Doubles(values.data(), values.size());
+    return true;
+}
+
+void MockRoboDK::_write_Line(tSession &s, const QString &line){
+    s.out.append(line.toUtf8());
+    s.out.append('\n');
+}
+void MockRoboDK::_write_Int(tSession &s, qint32 value){
+    uchar data[sizeof(qint32)];
+    qToBigEndian(value, data);
+    s.out.append(reinterpret_cast<const char *>(data), sizeof(data));
+}
+void MockRoboDK::_write_Item(tSession &s, quint64 ptr){
+    QMutexLocker lock(&_MUTEX);
+    QHash<quint64, tMockItem>::const_iterator item = _ITEMS.constFind(ptr);
+    bool valid = item != _ITEMS.constEnd();
+    qint32 type = valid ? item->type : -1;
+    lock.unlock();
+    uchar data[sizeof(quint64)];
+    qToBigEndian(valid ? ptr : quint64(0), data);
+    s.out.append(reinterpret_cast<const char *>(data), sizeof(data));
+    _write_Int(s, type);
+}
+void MockRoboDK::_write_Doubles(tSession &s, const double *values, int nvalues){
+    int start = s.out.size();
+    s.out.resize(start + nvalues*(int)sizeof(double));
+    uchar *out = reinterpret_cast<uchar *>(s.out.data() + start);
+    for (int i=0; i<nvalues; i++){
+        quint64 bits;
+        memcpy(&bits, values + i, sizeof(double));
+        qToBigEndian(bits, out + i*sizeof(double));
+    }
+}
+void MockRoboDK::_write_Array(tSession &s, const double *values, int nvalues){
+    _write_Int(s, nvalues);
+    _write_Doubles(s, values, nvalues);
+}
+void MockRoboDK::_write_Pose(tSession &s, const Mat &pose){
+    double m44[16];
+    for (int c=0; c<4; c++){
+        for (int r=0; r<4; r++){
+            m44[c*4+r] = pose.Get(r,c);
+        }
+    }
+    _write_Doubles(s, m44, 16);
+}
+void MockRoboDK::_write_Matrix2D(tSession &s, qint32 rows, qint32 cols, const double *values){
+    _write_Int(s, rows);
+    _write_Int(s, cols);
+    _write_Doubles(s, values, rows*cols);
+}
+void MockRoboDK::_write_Status(tSession &s, qint32 status){
+    _write_Int(s, status);
+}
@@ -0,0 +1,120 @@
+#ifndef MOCK_ROBODK_H
+#define MOCK_ROBODK_H
+
+#include <QtCore/QMutex>
+#include <QtCore/QHash>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <future>
+#include "../robodk_api.h"
+
+#ifndef RDK_SKIP_NAMESPACE
+using namespace RoboDK_API;
+#endif
+
+class QTcpSocket;
+class MockListener;
+
+/// <summary>
+/// Local stand-in for RoboDK that speaks the API wire protocol, so robodk_api.cpp can be exercised and benchmarked without the GUI.
+/// The station holds one UR3 robot ("UR3") solved with KinematicsUR and checked with CollisionUR, and one program ("Prog") whose joint list is canned.
+/// Every connection is served by its own thread with blocking reads, like the API client.
+/// Commands: G_Item, G_Item2, Version, G_Name, S_Name, S_Parent, Remove, G_Thetas, S_Thetas, G_RobLimits, G_FK, G_IK, G_IK_jnts, G_IK_cmpl,
+/// CollisionMove, CollisionMoveL, MoveX, WaitMove, AddPoints and G_ProgJointList. Any other command closes the connection, its arguments cannot be skipped.
+/// </summary>
+class MockRoboDK {
+    friend class MockListener;
+
+public:
+    MockRoboDK(const KinematicsUR &kinematics=KinematicsUR::UR3());
+    ~MockRoboDK();
+
+    /// <summary>
+    /// Number of points in the canned program joint list (10000 by default).
+    /// </summary>
+    void setProgramSteps(int nsteps);
+
+    /// <summary>
+    /// Listens on the port and serves the connections from a background thread until Stop is called.
+    /// </summary>
+    /// <param name="port">port to listen on, 0 for any free port (see Port)</param>
+    /// <returns>true if the port could be opened</returns>
+    bool Start(quint16 port=20500);
+
+    /// <summary>
+    /// Stops listening and waits for the open connections to finish.
+    /// </summary>
+    void Stop();
+
+    /// <summary>
+    /// Port the server listens on, 0 if it is not running.
+    /// </summary>
+    quint16 Port() const;
+
+    /// <summary>
+    /// Number of commands served so far, over all connections.
+    /// </summary>
+    qint64 Commands() const;
+
+private:
+    struct tMockItem {
+        QString name;
+        qint32 type;
+    };
+
+    /// one connection: the socket and the reply being built
+    struct tSession {
+        QTcpSocket *com;
+        QByteArray out;
+    };
+
+    void _serve(quint16 port, std::promise<quint16> *listening);
+    void _accept(qintptr socket);
+    void _session(qintptr socket);
+    bool _command(tSession &s, const QString &command);
+
+    // reads block until the data is there, false if the client went away
+    bool _read_Bytes(tSession &s, char *data, qint64 size);
+    bool _read_Line(tSession &s, QString &line);
+    bool _read_Int(tSession &s, qint32 &value);
+    bool _read_Item(tSession &s, quint64 &ptr);
+    bool _read_Array(tSession &s, QVector<double> &values);
+    bool _read_Pose(tSession &s, Mat &pose);
+    bool _read_Matrix2D(tSession &s, qint32 &rows, qint32 &cols, QVector<double> &values);
+
+    // writes go to the reply, sent once the command is complete
+    void _write_Line(tSession &s, const QString &line);
+    void _write_Int(tSession &s, qint32 value);
+    void _write_Item(tSession &s, quint64 ptr);
+    void _write_Doubles(tSession &s, const double *values, int nvalues);
+    void _write_Array(tSession &s, const double *values, int nvalues);
+    void _write_Pose(tSession &s, const Mat &pose);
+    void _write_Matrix2D(tSession &s, qint32 rows, qint32 cols, const double *values);
+    void _write_Status(tSession &s, qint32 status=0);
+
+    tJoints _joints();
+    void _build_Program();
+
+    KinematicsUR _KINEMATICS;
+    CollisionUR _COLLISION;
+
+    /// canned joint list of the program, 10 rows per step
+    int _PROGRAM_STEPS;
+    QVector<double> _PROGRAM;
+
+    /// station state shared by all connections
+    QMutex _MUTEX;
+    QHash<quint64, tMockItem> _ITEMS;
+    quint64 _NEXT_ITEM;
+    tJoints _JOINTS;
+
+    std::atomic<bool> _STOP;
+    quint16 _PORT;
+    std::atomic<qint64> _COMMANDS;
+    std::thread _LISTENER;
+    QMutex _THREADS_MUTEX;
+    std::vector<std::thread> _THREADS;
+};
+
+#endif // MOCK_ROBODK_H
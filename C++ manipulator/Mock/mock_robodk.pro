@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Mock RoboDK server: speaks the API protocol with canned UR3 kinematics
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT += network
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = mock_robodk
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+
+SOURCES += \
+        main.cpp \
+        mock_robodk.cpp \
+    ../robodk_api.cpp
+
+HEADERS += \
+        mock_robodk.h \
+    ../robodk_api.h
+
+include(../robodk_ik_lanes.pri)
@@ -0,0 +1,143 @@
+#include "../robodk_api.h"
+#include "../Mock/mock_robodk.h"
+#include <QCoreApplication>
+#include <cmath>
+#include <cstdio>
+
+#ifndef RDK_SKIP_NAMESPACE
+using namespace RoboDK_API;
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define TEST_STEPS 500 // points in the program joint list of the mock
+
+static int failures = 0;
+
+// Counts and prints a failed check
+static void check(bool ok, const char *name){
+    if (!ok){
+        printf("FAIL %s\n", name);
+        failures++;
+    }
+}
+
+static bool sameJoints(const tJoints &a, const tJoints &b, double tolerance){
+    if (a.Length() != b.Length()){
+        return false;
+    }
+    for (int i=0; i<a.Length(); i++){
+        if (!(fabs(a.ValuesD()[i] - b.ValuesD()[i]) <= tolerance)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool samePose(const Mat &a, const Mat &b, double tolerance){
+    for (int r=0; r<4; r++){
+        for (int c=0; c<4; c++){
+            if (!(fabs(a.Get(r, c) - b.Get(r, c)) <= tolerance)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Round trips of the RoboDK API against the mock server: mock_test
+// Exits with 1 if any reply does not match what the mock computes or serves.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    MockRoboDK mock;
+    mock.setProgramSteps(TEST_STEPS);
+    if (!mock.Start(0)){
+        printf("Cannot start the mock server\n");
+        return 1;
+    }
+    RoboDK rdk("127.0.0.1", mock.Port());
+    if (!rdk.Connected()){
+        printf("Cannot connect to the mock server on port %d\n", mock.Port());
+        return 1;
+    }
+    Item robot = rdk.getItem("UR3", RoboDK::ITEM_TYPE_ROBOT);
+    Item program = rdk.getItem("Prog", RoboDK::ITEM_TYPE_PROGRAM);
+    check(robot.Valid(), "getItem UR3");
+    check(program.Valid(), "getItem Prog");
+    if (!robot.Valid() || !program.Valid()){
+        return 1;
+    }
+
+    // FK and IK: the poses come from the UR3 model of the mock, IK must solve back to the joints
+    const KinematicsUR kinematics = KinematicsUR::UR3();
+    const double home_values[6] = {0, -90, 90, -90, -90, 0};
+    const double target_values[6] = {30, -70, 80, -100, -90, 20};
+    tJoints home(home_values, 6);
+    tJoints target(target_values, 6);
+    Mat pose = robot.SolveFK(home);
+    check(samePose(pose, kinematics.SolveFK(home), 1e-9), "SolveFK home");
+    Mat target_pose = robot.SolveFK(target);
+    check(samePose(target_pose, kinematics.SolveFK(target), 1e-9), "SolveFK target");
+    check(sameJoints(robot.SolveIK(pose, home), home, 1e-6), "SolveIK home");
+    check(sameJoints(robot.SolveIK(target_pose, target), target, 1e-6), "SolveIK target");
+
+    // MoveJ_Test: the same result as the collision model of the mock, the table is at z=0
+    CollisionUR collision = CollisionUR::UR3(kinematics);
+    const tXYZ up = {0, 0, 1};
+    collision.addObstaclePlane(up, 0);
+    const double down_values[6] = {0, 0, 90, 0, 0, 0}; // the arm reaches through the table
+    tJoints down(down_values, 6);
+    check(robot.MoveJ_Test(home, home) == 0, "MoveJ_Test home");
+    check(robot.MoveJ_Test(home, target) == collision.MoveJ_Test(home, target), "MoveJ_Test target");
+    int hit = robot.MoveJ_Test(home, down);
+    check(hit != 0, "MoveJ_Test into the table");
+    check(hit == collision.MoveJ_Test(home, down), "MoveJ_Test into the table, same as the model");
+
+    // AddPoints: the mock adds a point cloud item
+    const int npoints = 1000;
+    tMatrix2D *points = Matrix2D_Create();
+    Matrix2D_Set_Size(points, 3, npoints);
+    for (int i=0; i<3*npoints; i++){
+        points->data[i] = i % 100;
+    }
+    Item cloud = rdk.AddPoints(points, NULL, false, RoboDK::PROJECTION_NONE);
+    Matrix2D_Delete(&points);
+    check(cloud.Valid(), "AddPoints item");
+    check(cloud.Valid() && cloud.Name() == "Points", "AddPoints name");
+    if (cloud.Valid()){
+        cloud.Delete();
+    }
+
+    // InstructionListJoints: the canned joint list of the mock, 10 rows per point
+    tMatrix2D *joint_list = NULL;
+    QString error_msg;
+    program.InstructionListJoints(error_msg, &joint_list);
+    check(joint_list != NULL, "InstructionListJoints list");
+    if (joint_list != NULL){
+        check(Matrix2D_Size(joint_list, 1) == 10, "InstructionListJoints rows");
+        check(Matrix2D_Size(joint_list, 2) == TEST_STEPS, "InstructionListJoints columns");
+        if (Matrix2D_Size(joint_list, 1) == 10 && Matrix2D_Size(joint_list, 2) == TEST_STEPS){
+            bool same = true;
+            for (int i=0; i<TEST_STEPS; i++){
+                double t = (double)i / TEST_STEPS;
+                for (int j=0; j<6; j++){
+                    same = same && fabs(Matrix2D_Get_ij(joint_list, j, i) - 45.0 * sin(2*M_PI*t + j)) <= 1e-9;
+                }
+                same = same && Matrix2D_Get_ij(joint_list, 9, i) == i / 100;
+            }
+            check(same, "InstructionListJoints values");
+        }
+        Matrix2D_Delete(&joint_list);
+    }
+
+    if (failures > 0){
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
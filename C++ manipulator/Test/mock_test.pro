@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Round trip test of the RoboDK API against the mock server, run with make check
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT += network
+
+CONFIG += console c++11 testcase
+CONFIG -= app_bundle
+
+TARGET = mock_test
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+
+SOURCES += \
+        mock_test.cpp \
+    ../Mock/mock_robodk.cpp \
+    ../robodk_api.cpp
+
+HEADERS += \
+    ../Mock/mock_robodk.h \
+    ../robodk_api.h
+
+include(../robodk_ik_lanes.pri)
@@ -259,6 +259,12 @@
 
 
 #include <QtCore/QString>
+#include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
 #include <QtGui/QMatrix4x4> // this should not be part of the QtGui! it is just a matrix
 #include <QDebug>
 
@@ -275,6 +281,7 @@ namespace RoboDK_API {
 
 class Item;
 class RoboDK;
+class RoboDKPool;
 
 
 /// maximum size of robot joints (maximum allowed degrees of freedom for a robot)
@@ -378,6 +385,24 @@ struct tMatrix2D {
 
 
 
+/// \brief Status of a command sent in batch mode, as returned by RoboDK::BatchEnd.
+struct tBatchStatus {
+    /// Position of the command in the batch, starting at 0. Commands are counted as sent to RoboDK: a blocking MoveJ or MoveL is two commands (MoveX and WaitMove)
+    int index;
+
+    /// First line sent for the command, for example "S_Speed"
+    QString command;
+
+    /// Status code returned by RoboDK (2 is a warning, 3 an error)
+    int status;
+
+    /// Message sent by RoboDK with the warning or error
+    QString message;
+};
+
+
+
+
 //--------------------- Joints class -----------------------
 
 /// The tJoints class represents a joint position of a robot (robot axes).
@@ -753,6 +778,132 @@ private:
 
 };
 
+
+/// \brief Inverse kinematics result for one pose of a batch (see KinematicsUR::SolveIK_Batch).
+struct tIKResult {
+    /// Joint solution in degrees, not valid if the pose cannot be reached
+    tJoints joints;
+
+    /// Solution branch, 0 to 7: +4 for the second shoulder solution, +2 for a negative wrist (joint 5) and +1 for a negative elbow (joint 3). -1 if unknown or not feasible.
+    int branch;
+
+    /// True if the pose can be reached within the joint limits
+    bool feasible;
+};
+
+/// \brief The KinematicsUR class solves the forward and inverse kinematics of a UR type arm (UR3, UR5, UR10) in closed form, in process.
+/// Distances are in mm and joints in degrees, as everywhere else in the API. Use Item::setKinematicsUR to have the SolveFK and SolveIK methods of a robot item use it instead of RoboDK.
+class ROBODK KinematicsUR {
+
+public:
+    /// \brief Creates the model from the standard DH parameters in mm. The defaults are the ones of the UR3.
+    KinematicsUR(double d1=151.9, double a2=-243.65, double a3=-213.25, double d4=112.35, double d5=85.35, double d6=81.9);
+
+    static KinematicsUR UR3();
+    static KinematicsUR UR5();
+    static KinematicsUR UR10();
+
+    /// \brief Sets the pose of the DH base frame with respect to the robot base frame used by RoboDK.
+    void setBase(const Mat &base);
+
+    /// \brief Sets the joint limits in degrees. Solutions outside the limits are not returned.
+    void setJointLimits(const tJoints &lower, const tJoints &upper);
+
+    /// \brief Pose of the robot flange with respect to the robot base.
+    Mat SolveFK(const tJoints &joints) const;
+
+    /// \brief All joint solutions (up to 8) that place the robot flange at the pose, given with respect to the robot base.
+    /// \return number of solutions stored in solutions
+    int SolveIK_All(const Mat &pose, tJoints solutions[8]) const;
+
+    /// \brief The joint solution closest to joints_approx.
+    /// \return false if the pose cannot be reached
+    bool SolveIK(const Mat &pose, const tJoints &joints_approx, tJoints &joints) const;
+
+    /// \brief Solves many poses at once, for example all the candidate cuts of a frame. For every pose the solution closest to joints_approx is chosen.
+    /// The poses are solved several at a time so the compiler can use SIMD across them (robodk_ik_lanes.cpp, built with the vector math flags in robodk_ik_lanes.pri), and large batches are split over threads.
+    /// \param poses count poses of the robot flange with respect to the robot base
+    /// \param results count results, one per pose
+    /// \param nthreads number of threads, 0 for one per core
+    /// \return number of feasible poses
+    int SolveIK_Batch(const Mat *poses, int count, const tJoints &joints_approx, tIKResult *results, int nthreads=0) const;
+
+private:
+    enum { IK_LANES = 8 }; // poses solved together by _ik_Lanes
+
+    void _fk(const double q[6], double pose[16]) const;
+    void _fk_Frames(const double q[6], double frames[7][16]) const;
+    int _ik(const double pose[16], double q[8][6]) const;
+    void _ik_Lanes(const double pose[16][IK_LANES], double q[8][6][IK_LANES]) const;
+    int _solve_Block(const Mat *poses, int count, const tJoints &joints_approx, tIKResult *results) const;
+    bool _inLimits(double *joints, const double *joints_approx) const;
+
+    double _D1, _A2, _A3, _D4, _D5, _D6;
+
+    /// DH base in the robot base and its inverse, row major
+    double _Base[16];
+    double _BaseInv[16];
+
+    /// Joint limits in degrees
+    double _Lower[6];
+    double _Upper[6];
+
+    friend class CollisionUR;
+};
+
+/// \brief The CollisionUR class checks robot paths for collisions in process, with the links of a UR arm and the obstacles modelled as capsules (segments with a radius) and the table as a half space.
+/// It is coarser than the meshes RoboDK checks, so the capsules should be padded by the clearance needed. Use Item::setCollisionUR to have MoveJ_Test and MoveL_Test use it.
+class ROBODK CollisionUR {
+
+public:
+    /// \brief Creates an empty model for the arm. Add the links with addRobotCapsule or start from UR3().
+    CollisionUR(const KinematicsUR &kinematics=KinematicsUR());
+
+    /// \brief Envelope of the UR3 links.
+    static CollisionUR UR3(const KinematicsUR &kinematics=KinematicsUR::UR3());
+
+    void setKinematics(const KinematicsUR &kinematics);
+
+    /// \brief Adds a link. The points are in mm in DH frame 0 to 6: 0 is the DH base and frame i moves with joint i.
+    void addRobotCapsule(int frame, const tXYZ p1, const tXYZ p2, double radius);
+
+    /// \brief Adds an obstacle (for example the leg) as a capsule given in mm with respect to the robot base.
+    void addObstacleCapsule(const tXYZ p1, const tXYZ p2, double radius);
+
+    /// \brief Adds a half space the robot must stay out of: the points with DOT(normal, p) < offset, with respect to the robot base. The table top at height z is normal (0,0,1) and offset z.
+    void addObstaclePlane(const tXYZ normal, double offset);
+
+    void clearObstacles();
+
+    /// \brief Number of colliding pairs at the joints, 0 if there is no collision. Links on neighbouring frames are not checked against each other.
+    int Collisions(const tJoints &joints) const;
+
+    /// \brief Same semantics as Item::MoveJ_Test: the joints are interpolated in steps of at most minstep_deg (2 deg by default).
+    /// \return 0 if the movement is free of collision, otherwise the number of pairs colliding at the first colliding step
+    int MoveJ_Test(const tJoints &j1, const tJoints &j2, double minstep_deg=-1) const;
+
+    /// \brief Same semantics as Item::MoveL_Test for a flange pose with respect to the robot base: the path is interpolated in steps of at most minstep_mm (5 mm by default) and 2 deg, each step solved close to the previous one.
+    /// \return 0 if the movement is free of collision, the number of pairs colliding at the first colliding step, or -1 if the path cannot be followed (out of reach or through a singularity)
+    int MoveL_Test(const tJoints &j1, const Mat &pose2, double minstep_mm=-1) const;
+
+private:
+    struct tCapsule {
+        int frame; // DH frame of a link, -1 for an obstacle
+        double p1[3];
+        double p2[3];
+        double radius;
+    };
+    struct tPlane {
+        double normal[3];
+        double offset;
+    };
+
+    KinematicsUR _Kinematics;
+    QList<tCapsule> _Robot;
+    QList<tCapsule> _Obstacles;
+    QList<tPlane> _Planes;
+};
+
 /// <summary>
 /// This class is the iterface to the RoboDK API. With the RoboDK API you can automate certain tasks and operate on items.
 /// Interactions with items in the station tree are made through Items (IItem).
@@ -760,6 +911,7 @@ private:
 /// </summary>
 class ROBODK RoboDK {
     friend class RoboDK_API::Item;
+    friend class RoboDK_API::RoboDKPool;
 
 
 public:
@@ -775,6 +927,19 @@ public:
     void Disconnect();
     void Finish();
 
+    /// <summary>
+    /// Starts batch mode. Commands that only return a status are queued and sent together, without waiting for a reply after each one.
+    /// Their statuses are collected by BatchEnd. A command that returns a value collects the statuses queued before it first, so any command can be used inside a batch.
+    /// </summary>
+    void BatchStart();
+
+    /// <summary>
+    /// Ends batch mode. Sends the queued commands and collects their statuses.
+    /// </summary>
+    /// <param name="errors">optional list that receives the commands that returned a warning or an error</param>
+    /// <returns>number of commands that returned a warning or an error</returns>
+    int BatchEnd(QList<tBatchStatus> *errors=NULL);
+
 
     /// <summary>
     /// Returns an item by its name. If there is no exact match it will return the last closest match.
@@ -907,6 +1072,16 @@ public:
     /// <returns>added object/shape (0 if failed)</returns>
     Item AddPoints(Mat *points, Item *referenceObject = NULL, bool addToRef = false, int ProjectionType =  PROJECTION_ALONG_NORMAL_RECALC);
 
+    /// <summary>
+    /// Adds a list of points of any length to an object. The points are sent as one matrix, see CloudPublisher to keep a live cloud up to date.
+    /// </summary>
+    /// <param name="points">list of points as a matrix (3xN matrix, or 6xN to provide point normals as ijk vectors)</param>
+    /// <param name="reference_object">item to attach the newly added geometry (optional)</param>
+    /// <param name="add_to_ref">If True, the points will be added as part of the object in the RoboDK item tree (a reference object must be provided)</param>
+    /// <param name="projection_type">Type of projection.Use the PROJECTION_* flags.</param>
+    /// <returns>added object/shape (0 if failed)</returns>
+    Item AddPoints(tMatrix2D *points, Item *referenceObject = NULL, bool addToRef = false, int ProjectionType =  PROJECTION_ALONG_NORMAL_RECALC);
+
     /// <summary>
     /// Projects a point given its coordinates. The provided points must be a list of [XYZ] coordinates. Optionally, a vertex normal can be provided [XYZijk].
     /// </summary>
@@ -1615,6 +1790,11 @@ public:
 
 
 private:
+    // for RoboDKPool: set up the link without connecting, so it never starts RoboDK
+    enum tNoConnect { NO_CONNECT };
+    RoboDK(const QString &robodk_ip, int com_port, tNoConnect);
+    void _init(const QString &robodk_ip, int com_port, const QString &args, const QString &path);
+
     QTcpSocket *_COM;
     QString _IP;
     int _PORT;
@@ -1623,6 +1803,34 @@ private:
 
     QString _ROBODK_BIN; // file path to the robodk program (executable), typically C:/RoboDK/bin/RoboDK.exe. Leave empty to use the registry key: HKEY_LOCAL_MACHINE\SOFTWARE\RoboDK
     QString _ARGUMENTS;       // arguments to provide to RoboDK on startup
+    QByteArray _BUFFER;       // encoded message, kept so bulk writes do not allocate every call
+
+    // Batch mode: statuses that were not read yet, in the order RoboDK sends them
+    struct tPendingStatus {
+        int index;
+        QString command;
+        int timeout;
+    };
+    bool _BATCH;
+    bool _NEW_COMMAND;        // the next line sent is the name of a command
+    QString _COMMAND;         // name of the command being sent
+    int _BATCH_COUNT;         // commands sent since BatchStart
+    int _COMMAND_INDEX;       // position of the command being sent in the batch
+    QList<tPendingStatus> _PENDING;
+    QList<tBatchStatus> _BATCH_ERRORS;
+
+    // Local kinematics of robot items, by item pointer (see Item::setKinematicsUR)
+    QHash<quint64, KinematicsUR> _KINEMATICS;
+
+    // Local collision models of robot items, by item pointer (see Item::setCollisionUR)
+    QHash<quint64, CollisionUR> _COLLISION;
+
+    // Reference frame and inverse tool of the robots in _COLLISION, so MoveL_Test needs no round trip
+    struct tFrameTool {
+        Mat frame;
+        Mat tool_inv;
+    };
+    QHash<quint64, tFrameTool> _FRAME_TOOL;
 
     bool _connected();
     bool _connect();
@@ -1631,8 +1839,12 @@ private:
 
     bool _check_connection();
     bool _check_status();
+    qint32 _recv_Status(QString &message);
+    void _collect_Batch();
 
     bool _waitline();
+    bool _recv_Bytes(char *data, qint64 size);
+    bool _skip_Bytes(qint64 size);
     QString _recv_Line();//QString &string);
     bool _send_Line(const QString &string);
     int _recv_Int();//qint32 &value);
@@ -1644,7 +1856,7 @@ private:
     bool _send_Pose(const Mat &pose);
     bool _recv_XYZ(tXYZ pos);
     bool _send_XYZ(const tXYZ pos);
-    bool _recv_Array(double *values, int *psize=NULL);
+    bool _recv_Array(double *values, int max_values, int *psize=NULL);
     bool _send_Array(const double *values, int nvalues);
     bool _recv_Array(tJoints *jnts);
     bool _send_Array(const tJoints *jnts);
@@ -1665,6 +1877,7 @@ private:
 /// \image html station-tree.png
 class ROBODK Item {
     friend class RoboDK_API::RoboDK;
+    friend class RoboDK_API::RoboDKPool;
     
 public:
     Item(RoboDK *rdk=nullptr, quint64 ptr=0, qint32 type=-1);
@@ -1997,6 +2210,7 @@ public:
 
     /// <summary>
     /// Computes the inverse kinematics for the specified robot and pose. The joints returned are the closest to the current robot configuration (see SolveIK_All())
+    /// The current joints are read from RoboDK, so this takes a round trip even with a local model (see setKinematicsUR). Pass joints_approx to the other overload to avoid it.
     /// </summary>
     /// <param name="pose">4x4 matrix -> pose of the robot flange with respect to the robot base frame</param>
     /// <param name="joints_close">Aproximate joints solution to choose among the possible solutions. Leave this value empty to return the closest match to the current robot position.</param>
@@ -2033,6 +2247,45 @@ public:
     /// <returns>double x n x m -> joint list (2D matrix)</returns>
     QList<tJoints> SolveIK_All(const Mat &pose, const Mat *tool=nullptr, const Mat *ref=nullptr);
 
+    /// <summary>
+    /// Solves the kinematics of this robot in process with a UR model instead of asking RoboDK. SolveFK, SolveIK with joints_approx and SolveIK_All then need no round trip; SolveIK without joints_approx still reads the current joints from RoboDK.
+    /// The joint limits and the base offset of the model are loaded from RoboDK once, and the model is checked against the robot's own forward kinematics.
+    /// A collision model set with setCollisionUR is kept and uses the new model. If the model does not match, the collision model is dropped as well.
+    /// </summary>
+    /// <param name="model">UR model, for example KinematicsUR::UR3()</param>
+    /// <returns>true if the model matches the robot. Otherwise RoboDK is still used.</returns>
+    bool setKinematicsUR(const KinematicsUR &model);
+
+    /// <summary>
+    /// Computes the inverse kinematics of many poses at once, for example to check which candidate cuts are reachable.
+    /// With a local model (see setKinematicsUR) the poses are solved in process, otherwise the requests are sent to RoboDK together and the replies read afterwards.
+    /// </summary>
+    /// <param name="poses">poses of the robot tool with respect to the reference frame</param>
+    /// <param name="results">one result per pose: joints, solution branch and feasibility</param>
+    /// <param name="joints_approx">solutions closest to these joints are chosen. Leave empty to use the current robot position.</param>
+    /// <param name="tool">Optionally provide a tool pose, otherwise, the robot flange is used.</param>
+    /// <param name="ref">Optionally provide a reference pose, otherwise, the robot base is used.</param>
+    /// <returns>number of feasible poses</returns>
+    int SolveIK_Batch(const QList<Mat> &poses, QList<tIKResult> &results, const tJoints *joints_approx=nullptr, const Mat *tool=nullptr, const Mat *ref=nullptr);
+
+    /// <summary>
+    /// Goes back to solving the kinematics of this robot in RoboDK.
+    /// </summary>
+    void clearKinematicsUR();
+
+    /// <summary>
+    /// Checks the movements of this robot for collisions in process (MoveJ_Test and MoveL_Test) instead of asking RoboDK. Requires a local UR model (see setKinematicsUR); the calibrated model of the robot replaces the one in the collision model.
+    /// The active reference frame and tool are read here once for MoveL_Test. setPoseFrame and setPoseTool on this item keep them up to date; if they are changed any other way, call setCollisionUR again.
+    /// </summary>
+    /// <param name="model">collision model, for example CollisionUR::UR3() with the table and the leg added</param>
+    /// <returns>true if the model is used, false if the robot has no local kinematics</returns>
+    bool setCollisionUR(const CollisionUR &model);
+
+    /// <summary>
+    /// Goes back to checking collisions in RoboDK.
+    /// </summary>
+    void clearCollisionUR();
+
     /// <summary>
     /// Connect to a real robot using the corresponding robot driver.
     /// </summary>
@@ -2112,6 +2365,7 @@ public:
     /// <param name="j2">Destination joints</param>
     /// <param name="minstep_deg">Maximum joint step in degrees. If this value is not provided it will use the path step defined in Tools-Options-Motion (degrees).</param>
     /// <returns>collision : returns 0 if the movement is free of collision. Otherwise it returns the number of pairs of objects that collided if there was a collision.</returns>
+    /// With a local collision model (see setCollisionUR) the movement is checked in process.
     int MoveJ_Test(const tJoints &j1, const tJoints &j2, double minstep_deg = -1);
 
     /// <summary>
@@ -2121,6 +2375,7 @@ public:
     /// <param name="pose2">Destination pose (active tool with respect to the active reference frame)</param>
     /// <param name="minstep_mm">Maximum joint step in mm. If this value is not provided it will use the path step defined in Tools-Options-Motion (mm).</param>
     /// <returns>collision : returns 0 if the movement is free of collision. Otherwise it returns the number of pairs of objects that collided if there was a collision.</returns>
+    /// With a local collision model (see setCollisionUR) the movement is checked in process, and -1 is returned if the path cannot be followed.
     int MoveL_Test(const tJoints &joints1, const Mat &pose2, double minstep_mm = -1);
 
     /// <summary>
@@ -2348,6 +2603,102 @@ private:
 };
 
 
+/// \brief The CloudPublisher class keeps one object in RoboDK showing a live point cloud, for example the leg seen by the camera.
+/// The cloud is reduced to one point per voxel and sent only when enough voxels changed, at most once per interval, so it can be called from the analysis loop on every frame.
+class ROBODK CloudPublisher {
+
+public:
+    CloudPublisher(RoboDK *rdk, const QString &name="Live cloud");
+
+    /// \brief Voxel size in mm (after the scale), 5 mm by default.
+    void setLeafSize(double leaf_mm);
+
+    /// \brief Maximum points sent, 20000 by default. Larger decimated clouds are thinned further.
+    void setMaxPoints(int max_points);
+
+    /// \brief Share of the voxels that must appear or disappear before the object is updated, 0.05 by default.
+    void setChangeThreshold(double fraction);
+
+    /// \brief Minimum time between two updates in milliseconds, 200 by default.
+    void setMinInterval(int msec);
+
+    /// \brief Factor from the cloud units to mm, for example 1000 for a PCL cloud in metres.
+    void setScale(double scale);
+
+    /// \brief Reference frame to place the object in. The points are relative to it.
+    void setParent(const Item &parent);
+
+    /// \brief Decimates the cloud and updates the object if the rate limit and the change threshold allow it. Points are read every stride floats (4 for pcl::PointXYZ).
+    /// \return true if the object in RoboDK was updated
+    bool Publish(const float *xyz, int count, int stride=3, bool force=false);
+
+    /// \brief Removes the object from RoboDK.
+    void Clear();
+
+    /// \brief The object in RoboDK, not valid before the first update.
+    Item getItem() const;
+
+private:
+    RoboDK *_RDK;
+    QString _NAME;
+    Item _ITEM;
+    Item _PARENT;
+
+    double _LEAF;
+    double _SCALE;
+    double _CHANGE;
+    int _MAX_POINTS;
+    int _INTERVAL;
+
+    /// time of the last check
+    QElapsedTimer _TIMER;
+
+    /// sorted voxel keys of the cloud shown
+    QVector<quint64> _SENT;
+};
+
+
+/// \brief The RoboDKPool class opens several API links to the same RoboDK instance so worker threads can make queries in parallel.
+/// One RoboDK object and its socket must not be shared between threads. Each thread gets its own link from the pool instead, and Route moves an Item onto it:
+/// \code
+/// Item robot = pool.Route(shared_robot); // in the worker thread
+/// tJoints joints = robot.SolveIK(pose);
+/// pool.Release();                        // before the worker thread ends
+/// \endcode
+class ROBODK RoboDKPool {
+
+public:
+    RoboDKPool(int max_connections, const QString &robodk_ip="", int com_port=-1);
+    ~RoboDKPool();
+
+    /// \brief Link of the calling thread, opened on first use. Waits while max_connections links are open by other threads.
+    /// Only connects to a running RoboDK, it never starts one. Returns NULL if the link cannot be opened or was lost.
+    RoboDK *Session();
+
+    /// \brief The same item on the link of the calling thread, with its local kinematics and collision models. Invalid if Session fails.
+    Item Route(const Item &item);
+
+    /// \brief Closes the link of the calling thread.
+    void Release();
+
+    /// \brief Number of links open.
+    int Size();
+
+private:
+    int _MAX;
+    QString _IP;
+    int _PORT;
+
+    QMutex _MUTEX;
+    QWaitCondition _FREE;
+
+    /// link of each thread, NULL while it connects
+    QHash<Qt::HANDLE, RoboDK*> _SESSIONS;
+
+    RoboDK *_drop(Qt::HANDLE thread, RoboDK *rdk);
+};
+
+
 
 /// Translation matrix class: Mat::transl.
 ROBODK Mat transl(double x, double y, double z);
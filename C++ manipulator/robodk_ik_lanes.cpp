@@ -0,0 +1,90 @@
+#include "robodk_api.h"
+#include <cstring>
+#include <cmath>
+
+// Only the batched inverse kinematics kernel is here, so it can be built with
+// the vector math flags while the rest of the API keeps the default ones.
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327950288
+#endif
+#ifndef M_PI_2
+#define M_PI_2 1.57079632679489661923132169163975144
+#endif
+
+
+#ifndef RDK_SKIP_NAMESPACE
+namespace RoboDK_API {
+#endif
+
+// Inverse of IK_LANES poses at once, in the branch order of tIKResult::branch.
+// Every step is a loop over the lanes without branches, so the compiler can
+// vectorize across poses. Unreachable branches come out as NaN, from acos or
+// asin out of [-1, 1]; _solve_Block checks for them and is not built with
+// fast math.
+// The loops only vectorize if the compiler may call the vector math library
+// (see robodk_ik_lanes.pri), and only if nothing stops it:
+// - a sin and a cos of the same angle would be merged into one sincos call,
+//   which has no vector version, so the cosines are taken as shifted sines
+// - calls must not be conditional
+// - the lane loop writes to local arrays only, so it needs no alias checks
+//   against the poses
+void KinematicsUR::_ik_Lanes(const double T[16][IK_LANES], double q[8][6][IK_LANES]) const{
+    const double d1 = _D1, a2 = _A2, a3 = _A3, d4 = _D4, d5 = _D5, d6 = _D6;
+    double psi[IK_LANES], phi[IK_LANES];
+    for (int l=0; l<IK_LANES; l++){
+        // wrist centre (origin of frame 5)
+        double px = T[3][l] - d6*T[2][l];
+        double py = T[7][l] - d6*T[6][l];
+        psi[l] = atan2(py, px);
+        phi[l] = asin(d4 / sqrt(px*px + py*py));
+    }
+    for (int b=0; b<8; b++){
+        const double wrist = (b & 2) ? -1.0 : 1.0;
+        const double elbow = (b & 1) ? -1.0 : 1.0;
+        const double shoulder = (b & 4) ? -1.0 : 1.0;
+        const double turn = (b & 4) ? M_PI : 0.0;
+        double t[6][IK_LANES];
+        for (int l=0; l<IK_LANES; l++){
+            double t1 = psi[l] + turn + shoulder*phi[l];
+            double s1 = sin(t1), c1 = sin(t1 + M_PI_2);
+            double t5 = wrist * acos((T[3][l]*s1 - T[7][l]*c1 - d4) / d6);
+            double s5 = sin(t5), c5 = sin(t5 + M_PI_2);
+            double y6 = -(T[1][l]*s1 - T[5][l]*c1), x6 = T[0][l]*s1 - T[4][l]*c1;
+            // atan2(y6/s5, x6/s5) is atan2 of the pair flipped by the sign of s5;
+            // joint 6 is free when s5 is 0
+            double sign5 = s5 < 0 ? -1.0 : 1.0;
+            double a6 = atan2(sign5*y6, sign5*x6);
+            double t6 = fabs(s5) > 1e-9 ? a6 : 0.0;
+            double s6 = sin(t6), c6 = sin(t6 + M_PI_2);
+
+            // first two rows of A1^-1 T, then times (A5 A6)^-1 written out
+            double m00 = c1*T[0][l] + s1*T[4][l], m01 = c1*T[1][l] + s1*T[5][l];
+            double m02 = c1*T[2][l] + s1*T[6][l], m03 = c1*T[3][l] + s1*T[7][l];
+            double m10 = T[8][l], m11 = T[9][l], m12 = T[10][l], m13 = T[11][l] - d1;
+            double r00 = m00*c5*c6 - m01*c5*s6 - m02*s5;
+            double r01 = m00*s5*c6 - m01*s5*s6 + m02*c5;
+            double r03 = m03 + (m00*s6 + m01*c6)*d5 - m02*d6;
+            double r10 = m10*c5*c6 - m11*c5*s6 - m12*s5;
+            double r11 = m10*s5*c6 - m11*s5*s6 + m12*c5;
+            double r13 = m13 + (m10*s6 + m11*c6)*d5 - m12*d6;
+
+            // planar 2R problem for the parallel joints
+            double qx = r03 - d4*r01;
+            double qy = r13 - d4*r11;
+            double t3 = elbow * acos((qx*qx + qy*qy - a2*a2 - a3*a3) / (2*a2*a3));
+            double t2 = atan2(qy, qx) - atan2(a3*sin(t3), a2 + a3*sin(t3 + M_PI_2));
+            t[0][l] = t1;
+            t[1][l] = t2;
+            t[2][l] = t3;
+            t[3][l] = atan2(r10, r00) - t2 - t3;
+            t[4][l] = t5;
+            t[5][l] = t6;
+        }
+        memcpy(q[b], t, sizeof(t));
+    }
+}
+
+#ifndef RDK_SKIP_NAMESPACE
+}
+#endif
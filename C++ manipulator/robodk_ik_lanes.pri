@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Batched UR inverse kinematics kernel (KinematicsUR::_ik_Lanes), include this
+# next to robodk_api.cpp in any project that builds the API
+#
+#-------------------------------------------------
+
+# The kernel solves 8 poses per loop and only vectorizes when GCC may call the glibc
+# vector math library (libmvec; acos, asin and atan2 need glibc 2.35), which glibc
+# declares under -ffast-math. Only this file gets the flags: the rest of the API keeps
+# IEEE semantics and checks the kernel's NaN results itself.
+# Add -mavx2 -mfma for 4 lanes per vector if every target machine has them.
+linux-g++* {
+    IK_LANES_SOURCES = $$PWD/robodk_ik_lanes.cpp
+    ik_lanes.input = IK_LANES_SOURCES
+    ik_lanes.output = ${QMAKE_VAR_OBJECTS_DIR}${QMAKE_FILE_BASE}$${first(QMAKE_EXT_OBJ)}
+    ik_lanes.commands = $(CXX) -c $(CXXFLAGS) -O3 -ffast-math $(INCPATH) -o ${QMAKE_FILE_OUT} ${QMAKE_FILE_IN}
+    ik_lanes.dependency_type = TYPE_C
+    ik_lanes.variable_out = OBJECTS
+    QMAKE_EXTRA_COMPILERS += ik_lanes
+} else {
+    SOURCES += $$PWD/robodk_ik_lanes.cpp
+}
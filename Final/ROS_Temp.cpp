@@ -7,6 +7,10 @@
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/sample_consensus/model_types.h>
 #include <pcl/segmentation/sac_segmentation.h>
+#include <pcl/filters/passthrough.h>
+#include <pcl/filters/project_inliers.h>
+#include <pcl/surface/concave_hull.h>
+#include "LegAnalyzer.h"
 //c++
 
 #include <math.h>
@@ -32,24 +36,59 @@
 using namespace std;
 
 ros::Publisher pub;
+LegAnalyzer analyzer; //sized once in main, buffers reused between frames
 //Functions here//
 void callBack(const sensor_msgs::PointCloud2ConstPtr& input)
 {
     pcl::PCLPointCloud2::Ptr cloud_in(new pcl::PCLPointCloud2);
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_in (new pcl::PointCloud<pcl::PointXYZ>);
     pcl::PointCloud<pcl::PointXYZ>::Ptr cloud (new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_projected (new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_hull (new pcl::PointCloud<pcl::PointXYZ>);
 
     //Using the PointCloud2 data from the ROS topic
     pcl_conversions::toPCL(*input, *cloud_in);
 
     // Convert to the templated PointCloud
     pcl::fromPCLPointCloud2(*cloud_in, *cloud);
-    /////////////
-    
-    //Code here//
-    
-    /////////////
-    
+
+    // Remove the table surroundings
+    pcl::PassThrough<pcl::PointXYZ> pass;
+    pass.setInputCloud(cloud);
+    pass.setFilterFieldName("z");
+    pass.setFilterLimits(0, 1.1);
+    pass.filter(*cloud);
+
+    // Project the leg onto its plane and take the outline
+    pcl::ModelCoefficients::Ptr coefficients (new pcl::ModelCoefficients);
+    pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
+    pcl::SACSegmentation<pcl::PointXYZ> seg;
+    seg.setOptimizeCoefficients(true);
+    seg.setModelType(pcl::SACMODEL_PLANE);
+    seg.setMethodType(pcl::SAC_RANSAC);
+    seg.setDistanceThreshold(0.01);
+    seg.setInputCloud(cloud);
+    seg.segment(*inliers, *coefficients);
+
+    pcl::ProjectInliers<pcl::PointXYZ> proj;
+    proj.setModelType(pcl::SACMODEL_PLANE);
+    proj.setIndices(inliers);
+    proj.setInputCloud(cloud);
+    proj.setModelCoefficients(coefficients);
+    proj.filter(*cloud_projected);
+
+    pcl::ConcaveHull<pcl::PointXYZ> chull;
+    chull.setInputCloud(cloud_projected);
+    chull.setAlpha(0.01);
+    chull.reconstruct(*cloud_hull);
+
+    // Contour -> cut -> pose
+    CutPose cut = analyzer.process(*cloud_hull);
+    if (!cut.valid)
+    {
+        return;
+    }
+    const float *pose1 = cut.pose;
+
     std_msgs::Float32MultiArray output;
    output.data.clear();
 
@@ -68,6 +107,9 @@ int main (int argc, char** argv)
     ros::init(argc, argv, "my_pcl_tutorial");
     ros::NodeHandle nh;
 
+    // The outline is a few hundred points, size the buffers once
+    analyzer.reserve(1000);
+
     // Create a ROS subscriber for the input point cloud
     ros::Subscriber sub = nh.subscribe("/kinect2/sd/points", 1, callBack);
 
@@ -0,0 +1,168 @@
+#include "BoxStage.h"
+
+#include <limits>
+#include <Eigen/Eigenvalues>
+#include <pcl/common/point_tests.h>
+
+BoxStage::BoxStage()
+{
+    reset();
+}
+
+void BoxStage::reset()
+{
+    origin_.setZero();
+    sum_.setZero();
+    products_.setZero();
+    aabb_min_.setConstant(std::numeric_limits<float>::max());
+    aabb_max_.setConstant(-std::numeric_limits<float>::max());
+    count_ = 0;
+    mean_.setZero();
+    axes_.setIdentity();
+    values_.setZero();
+    obb_min_.setZero();
+    obb_max_.setZero();
+    obb_position_.setZero();
+}
+
+void BoxStage::crop(const pcl::PointCloud<pcl::PointXYZ> &cloud, const Eigen::Vector3f &min,
+                    const Eigen::Vector3f &max, std::vector<int> &kept)
+{
+    kept.clear();
+    for (size_t i = 0; i < cloud.points.size(); ++i)
+    {
+        const pcl::PointXYZ &p = cloud.points[i];
+        // NaN fails both comparisons, so unseen points drop out here too
+        if ((p.getArray3fMap() >= min.array()).all() && (p.getArray3fMap() <= max.array()).all())
+        {
+            add(p);
+            kept.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+void BoxStage::accumulate(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices)
+{
+    for (size_t k = 0; k < indices.size(); ++k)
+    {
+        add(cloud.points[indices[k]]);
+    }
+}
+
+void BoxStage::accumulate(const pcl::PointCloud<pcl::PointXYZ> &cloud)
+{
+    for (size_t i = 0; i < cloud.points.size(); ++i)
+    {
+        const pcl::PointXYZ &p = cloud.points[i];
+        if (!pcl::isFinite(p))
+        {
+            continue;
+        }
+        add(p);
+    }
+}
+
+bool BoxStage::compute(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices)
+{
+    if (!solve())
+    {
+        return false;
+    }
+    Eigen::Vector3f low, high;
+    low.setConstant(std::numeric_limits<float>::max());
+    high.setConstant(-std::numeric_limits<float>::max());
+    for (size_t k = 0; k < indices.size(); ++k)
+    {
+        project(cloud.points[indices[k]], low, high);
+    }
+    finishOBB(low, high);
+    return true;
+}
+
+bool BoxStage::compute(const pcl::PointCloud<pcl::PointXYZ> &cloud)
+{
+    if (!solve())
+    {
+        return false;
+    }
+    Eigen::Vector3f low, high;
+    low.setConstant(std::numeric_limits<float>::max());
+    high.setConstant(-std::numeric_limits<float>::max());
+    for (size_t i = 0; i < cloud.points.size(); ++i)
+    {
+        if (pcl::isFinite(cloud.points[i]))
+        {
+            project(cloud.points[i], low, high);
+        }
+    }
+    finishOBB(low, high);
+    return true;
+}
+
+bool BoxStage::solve()
+{
+    if (count_ < 3)
+    {
+        return false;
+    }
+    const Eigen::Vector3d mean = sum_ / static_cast<double>(count_);
+    const Eigen::Matrix3d covariance = products_ / static_cast<double>(count_) - mean * mean.transpose();
+    mean_ = (origin_ + mean).cast<float>();
+
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+    solver.computeDirect(covariance);
+
+    // Largest first, minor completing a right-handed frame as in MomentOfInertiaEstimation
+    const Eigen::Vector3f major = solver.eigenvectors().col(2).cast<float>();
+    const Eigen::Vector3f middle = solver.eigenvectors().col(1).cast<float>();
+    axes_.col(0) = major;
+    axes_.col(1) = middle;
+    axes_.col(2) = major.cross(middle);
+    values_ = Eigen::Vector3f(solver.eigenvalues()(2), solver.eigenvalues()(1), solver.eigenvalues()(0));
+    return true;
+}
+
+void BoxStage::project(const pcl::PointXYZ &p, Eigen::Vector3f &low, Eigen::Vector3f &high) const
+{
+    const Eigen::Vector3f local = axes_.transpose() * (p.getVector3fMap() - mean_);
+    low = low.cwiseMin(local);
+    high = high.cwiseMax(local);
+}
+
+void BoxStage::finishOBB(const Eigen::Vector3f &low, const Eigen::Vector3f &high)
+{
+    // Centre the box on its own middle, as MomentOfInertiaEstimation does
+    const Eigen::Vector3f shift = (low + high) / 2.0f;
+    obb_min_ = low - shift;
+    obb_max_ = high - shift;
+    obb_position_ = mean_ + axes_ * shift;
+}
+
+void BoxStage::getAABB(pcl::PointXYZ &min_point, pcl::PointXYZ &max_point) const
+{
+    min_point.getVector3fMap() = aabb_min_;
+    max_point.getVector3fMap() = aabb_max_;
+}
+
+void BoxStage::getOBB(pcl::PointXYZ &min_point, pcl::PointXYZ &max_point, pcl::PointXYZ &position,
+                      Eigen::Matrix3f &rotation) const
+{
+    min_point.getVector3fMap() = obb_min_;
+    max_point.getVector3fMap() = obb_max_;
+    position.getVector3fMap() = obb_position_;
+    rotation = axes_;
+}
+
+void BoxStage::getEigenValues(float &major, float &middle, float &minor) const
+{
+    major = values_(0);
+    middle = values_(1);
+    minor = values_(2);
+}
+
+void BoxStage::getEigenVectors(Eigen::Vector3f &major, Eigen::Vector3f &middle, Eigen::Vector3f &minor) const
+{
+    major = axes_.col(0);
+    middle = axes_.col(1);
+    minor = axes_.col(2);
+}
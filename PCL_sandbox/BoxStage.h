@@ -0,0 +1,83 @@
+#ifndef BOX_STAGE_H
+#define BOX_STAGE_H
+
+#include <vector>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+// Mass centre, principal axes and bounding boxes of a cluster: the part of
+// pcl::MomentOfInertiaEstimation the tools actually use, without the moment
+// of inertia and eccentricity sweeps. Mean and covariance are summed in one
+// pass, which can be the crop itself; the axes come from a closed-form 3x3
+// eigen solve and the OBB from projecting the kept points once.
+class BoxStage
+{
+public:
+    BoxStage();
+
+    void reset();
+
+    // Sum one point. Points must be finite.
+    void add(const pcl::PointXYZ &p)
+    {
+        if (count_ == 0)
+        {
+            origin_ = p.getVector3fMap().cast<double>();
+        }
+        const Eigen::Vector3d v = p.getVector3fMap().cast<double>() - origin_;
+        sum_ += v;
+        products_ += v * v.transpose();
+        aabb_min_ = aabb_min_.cwiseMin(p.getVector3fMap());
+        aabb_max_ = aabb_max_.cwiseMax(p.getVector3fMap());
+        count_++;
+    }
+
+    // Pass-through crop fused with the sums: keeps the finite points inside
+    // [min, max] on every axis (use +-infinity for open sides), summing them
+    // on the way
+    void crop(const pcl::PointCloud<pcl::PointXYZ> &cloud, const Eigen::Vector3f &min, const Eigen::Vector3f &max,
+              std::vector<int> &kept);
+
+    // Sums of all listed points, or the whole cloud
+    void accumulate(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices);
+    void accumulate(const pcl::PointCloud<pcl::PointXYZ> &cloud);
+
+    // Axes and OBB from the sums. The points are those that were summed.
+    // Returns false if fewer than three points were summed.
+    bool compute(const pcl::PointCloud<pcl::PointXYZ> &cloud, const std::vector<int> &indices);
+    bool compute(const pcl::PointCloud<pcl::PointXYZ> &cloud);
+
+    // Same meaning as the MomentOfInertiaEstimation getters
+    void getAABB(pcl::PointXYZ &min_point, pcl::PointXYZ &max_point) const;
+    void getOBB(pcl::PointXYZ &min_point, pcl::PointXYZ &max_point, pcl::PointXYZ &position,
+                Eigen::Matrix3f &rotation) const;
+    void getEigenValues(float &major, float &middle, float &minor) const;
+    void getEigenVectors(Eigen::Vector3f &major, Eigen::Vector3f &middle, Eigen::Vector3f &minor) const;
+    void getMassCenter(Eigen::Vector3f &mass_center) const { mass_center = mean_; }
+    size_t size() const { return count_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+    bool solve();
+    void project(const pcl::PointXYZ &p, Eigen::Vector3f &low, Eigen::Vector3f &high) const;
+    void finishOBB(const Eigen::Vector3f &low, const Eigen::Vector3f &high);
+
+    // Sums, taken relative to the first point to keep the covariance exact
+    Eigen::Vector3d origin_;
+    Eigen::Vector3d sum_;
+    Eigen::Matrix3d products_;
+    Eigen::Vector3f aabb_min_;
+    Eigen::Vector3f aabb_max_;
+    size_t count_;
+
+    Eigen::Vector3f mean_;
+    Eigen::Matrix3f axes_; // major, middle, minor as columns
+    Eigen::Vector3f values_;
+    Eigen::Vector3f obb_min_;
+    Eigen::Vector3f obb_max_;
+    Eigen::Vector3f obb_position_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "CurvatureStage.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <Eigen/Eigenvalues>
+
+CurvatureStage::Config::Config() :
+    maxNeighbours(0),
+    threads(0)
+{
+    // Tool sized: from the surface texture up to about the leg width
+    scales.push_back(0.01f);
+    scales.push_back(0.02f);
+    scales.push_back(0.04f);
+    scales.push_back(0.08f);
+}
+
+CurvatureStage::CurvatureStage()
+{
+    configure(Config());
+}
+
+CurvatureStage::CurvatureStage(const Config &config)
+{
+    configure(config);
+}
+
+void CurvatureStage::configure(const Config &config)
+{
+    config_ = config;
+    std::sort(config_.scales.begin(), config_.scales.end());
+    if (config_.threads == 0)
+    {
+        config_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    sqr_scales_.resize(config_.scales.size());
+    for (size_t s = 0; s < config_.scales.size(); ++s)
+    {
+        sqr_scales_[s] = config_.scales[s] * config_.scales[s];
+    }
+    graph_.setNumberOfThreads(config_.threads);
+}
+
+void CurvatureStage::compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud,
+                             const pcl::PointCloud<pcl::Normal> &normals, Eigen::MatrixXf &signature)
+{
+    const size_t n = cloud->points.size();
+    signature.resize(n, 2 * config_.scales.size());
+    if (n == 0 || config_.scales.empty())
+    {
+        return;
+    }
+
+    graph_.build(cloud, config_.scales.back(), config_.maxNeighbours);
+
+    const size_t nr_blocks = std::max<size_t>(1, std::min<size_t>(config_.threads, n));
+    std::vector<std::thread> workers;
+    for (size_t b = 1; b < nr_blocks; ++b)
+    {
+        workers.push_back(std::thread(&CurvatureStage::computeRange, this, std::cref(normals),
+                                      b * n / nr_blocks, (b + 1) * n / nr_blocks, &signature));
+    }
+    computeRange(normals, 0, n / nr_blocks, &signature);
+    for (size_t t = 0; t < workers.size(); ++t)
+    {
+        workers[t].join();
+    }
+}
+
+void CurvatureStage::computeRange(const pcl::PointCloud<pcl::Normal> &normals, size_t first, size_t last,
+                                  Eigen::MatrixXf *signature) const
+{
+    // Same quantity as pcl::PrincipalCurvaturesEstimation: eigenvalues of the
+    // covariance of the neighbour normals projected onto the tangent plane.
+    // Kept as raw sums per scale so the scales can be added together.
+    const size_t nr_scales = sqr_scales_.size();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<int> counts(nr_scales);
+    std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > sums(nr_scales);
+    std::vector<Eigen::Matrix3d, Eigen::aligned_allocator<Eigen::Matrix3d> > squares(nr_scales);
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+
+    const std::vector<int> &indices = graph_.indices();
+    const std::vector<float> &sqr_dists = graph_.sqrDistances();
+    for (size_t i = first; i < last; ++i)
+    {
+        const Eigen::Vector3f normal = normals.points[i].getNormalVector3fMap();
+        if (!normal.allFinite())
+        {
+            signature->row(i).setConstant(nan);
+            continue;
+        }
+
+        std::fill(counts.begin(), counts.end(), 0);
+        for (size_t s = 0; s < nr_scales; ++s)
+        {
+            sums[s].setZero();
+            squares[s].setZero();
+        }
+
+        for (size_t j = graph_.begin(i); j < graph_.end(i); ++j)
+        {
+            const Eigen::Vector3f other = normals.points[indices[j]].getNormalVector3fMap();
+            if (!other.allFinite())
+            {
+                continue;
+            }
+            const size_t s = std::lower_bound(sqr_scales_.begin(), sqr_scales_.end(), sqr_dists[j])
+                           - sqr_scales_.begin();
+            if (s == nr_scales)
+            {
+                continue;
+            }
+            const Eigen::Vector3d projected = (other - normal * normal.dot(other)).cast<double>();
+            counts[s]++;
+            sums[s] += projected;
+            squares[s] += projected * projected.transpose();
+        }
+
+        int count = 0;
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        Eigen::Matrix3d square = Eigen::Matrix3d::Zero();
+        for (size_t s = 0; s < nr_scales; ++s)
+        {
+            count += counts[s];
+            sum += sums[s];
+            square += squares[s];
+            if (count == 0)
+            {
+                (*signature)(i, 2 * s) = (*signature)(i, 2 * s + 1) = nan;
+                continue;
+            }
+            const Eigen::Vector3d mean = sum / count;
+            const Eigen::Matrix3d covariance = square / count - mean * mean.transpose();
+            solver.computeDirect(covariance, Eigen::EigenvaluesOnly);
+            (*signature)(i, 2 * s) = static_cast<float>(solver.eigenvalues()(2));
+            (*signature)(i, 2 * s + 1) = static_cast<float>(solver.eigenvalues()(1));
+        }
+    }
+}
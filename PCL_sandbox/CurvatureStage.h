@@ -0,0 +1,56 @@
+#ifndef CURVATURE_STAGE_H
+#define CURVATURE_STAGE_H
+
+#include <vector>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include "NeighbourhoodGraph.h"
+
+// Principal curvatures at several radii from one neighbourhood search. The
+// graph is built once at the largest radius; each neighbour is then added to
+// the smallest scale that contains it and the scales are summed outwards, so
+// every extra scale costs one 3x3 eigen solve per point instead of a search.
+// Points are split over threads for both the search and the sweep.
+//
+// Row i of the signature holds pc1 and pc2 of point i for every scale,
+// smallest scale first. Near the joint the small scales stay flat-ish while
+// the large ones bend, so the ratio between columns separates it from the
+// straight parts of the leg.
+class CurvatureStage
+{
+public:
+    struct Config
+    {
+        Config();
+
+        std::vector<float> scales;  // neighbourhood radii (m), the largest bounds the search
+        unsigned int maxNeighbours; // cap on the neighbours per point, 0 for none
+        unsigned int threads;       // worker threads, 0 for one per core
+    };
+
+    CurvatureStage();
+    explicit CurvatureStage(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+    size_t scaleCount() const { return config_.scales.size(); }
+
+    // normals must match cloud point for point. Points without a valid normal
+    // or without neighbours at a scale get NaN in those columns.
+    void compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+                 Eigen::MatrixXf &signature);
+
+    // Neighbour lists of the last frame, for later stages on the same cloud
+    const NeighbourhoodGraph<pcl::PointXYZ> &graph() const { return graph_; }
+
+private:
+    void computeRange(const pcl::PointCloud<pcl::Normal> &normals, size_t first, size_t last,
+                      Eigen::MatrixXf *signature) const;
+
+    Config config_;
+    std::vector<float> sqr_scales_;
+    NeighbourhoodGraph<pcl::PointXYZ> graph_;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "CylinderFitter.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <Eigen/Dense>
+
+namespace
+{
+// Two unit vectors completing a to an orthonormal basis
+void tangents(const Eigen::Vector3f &a, Eigen::Vector3f &t1, Eigen::Vector3f &t2)
+{
+    t1 = a.unitOrthogonal();
+    t2 = a.cross(t1);
+}
+}
+
+void CylinderAxis::toCoefficients(pcl::ModelCoefficients &coefficients) const
+{
+    coefficients.values.resize(7);
+    coefficients.values[0] = point(0);
+    coefficients.values[1] = point(1);
+    coefficients.values[2] = point(2);
+    coefficients.values[3] = direction(0);
+    coefficients.values[4] = direction(1);
+    coefficients.values[5] = direction(2);
+    coefficients.values[6] = radius;
+}
+
+CylinderFitter::Config::Config() :
+    iterations(5),
+    normalWeight(0.01f),
+    huberDistance(0.01f),
+    maxRadius(0.1f)
+{}
+
+CylinderFitter::CylinderFitter()
+{
+    configure(Config());
+}
+
+CylinderFitter::CylinderFitter(const Config &config)
+{
+    configure(config);
+}
+
+void CylinderFitter::configure(const Config &config)
+{
+    config_ = config;
+}
+
+CylinderAxis CylinderFitter::fit(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                                 const pcl::PointCloud<pcl::Normal> &normals)
+{
+    CylinderAxis axis;
+    axis.valid = false;
+    axis.radius = 0.0f;
+    axis.rms = 0.0f;
+    axis.point = axis.direction = axis.start = axis.end = Eigen::Vector3f::Zero();
+    if (cloud.points.size() < 5)
+    {
+        return axis;
+    }
+
+    initialise(cloud, axis);
+    for (int i = 0; i < config_.iterations; i++)
+    {
+        if (!step(cloud, normals, axis))
+        {
+            break;
+        }
+    }
+    finish(cloud, axis);
+    return axis;
+}
+
+void CylinderFitter::initialise(const pcl::PointCloud<pcl::PointXYZ> &cloud, CylinderAxis &axis) const
+{
+    // Major PCA direction through the centroid, radius the mean distance to it
+    const size_t n = cloud.points.size();
+    Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+    for (size_t i = 0; i < n; i++)
+    {
+        mean += cloud.points[i].getVector3fMap().cast<double>();
+    }
+    mean /= n;
+    Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+    for (size_t i = 0; i < n; i++)
+    {
+        const Eigen::Vector3d d = cloud.points[i].getVector3fMap().cast<double>() - mean;
+        covariance += d * d.transpose();
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+    solver.computeDirect(covariance);
+
+    axis.point = mean.cast<float>();
+    axis.direction = solver.eigenvectors().col(2).cast<float>();
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; i++)
+    {
+        const Eigen::Vector3f v = cloud.points[i].getVector3fMap() - axis.point;
+        sum += (v - axis.direction * axis.direction.dot(v)).norm();
+    }
+    axis.radius = sum / n;
+}
+
+bool CylinderFitter::step(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+                          CylinderAxis &axis) const
+{
+    // Parameters: axis point moved along t1, t2, axis tilted towards t1, t2,
+    // and the radius. Normal equations accumulated in double.
+    const Eigen::Vector3f a = axis.direction;
+    Eigen::Vector3f t1, t2;
+    tangents(a, t1, t2);
+    const bool use_normals = normals.points.size() == cloud.points.size() && config_.normalWeight > 0.0f;
+
+    typedef Eigen::Matrix<double, 5, 1> Vector5d;
+    Eigen::Matrix<double, 5, 5> jtj = Eigen::Matrix<double, 5, 5>::Zero();
+    Vector5d jtr = Vector5d::Zero();
+    for (size_t i = 0; i < cloud.points.size(); i++)
+    {
+        const Eigen::Vector3f v = cloud.points[i].getVector3fMap() - axis.point;
+        const float along = a.dot(v);
+        const Eigen::Vector3f w = v - a * along;
+        const float d = w.norm();
+        if (d < std::numeric_limits<float>::epsilon())
+        {
+            continue;
+        }
+        const Eigen::Vector3f e = w / d;
+
+        Vector5d j;
+        j << -e.dot(t1), -e.dot(t2), -e.dot(t1) * along, -e.dot(t2) * along, -1.0;
+        const double r = d - axis.radius;
+        const double weight = fabs(r) <= config_.huberDistance ? 1.0 : config_.huberDistance / fabs(r);
+        jtj += weight * j * j.transpose();
+        jtr += weight * j * r;
+
+        if (use_normals)
+        {
+            const Eigen::Vector3f n = normals.points[i].getNormalVector3fMap();
+            if (!n.allFinite())
+            {
+                continue;
+            }
+            Vector5d jn;
+            jn << 0.0, 0.0, config_.normalWeight * n.dot(t1), config_.normalWeight * n.dot(t2), 0.0;
+            const double rn = config_.normalWeight * n.dot(a);
+            jtj += jn * jn.transpose();
+            jtr += jn * rn;
+        }
+    }
+
+    const Vector5d delta = jtj.ldlt().solve(-jtr);
+    if (!delta.allFinite())
+    {
+        return false;
+    }
+    axis.point += static_cast<float>(delta(0)) * t1 + static_cast<float>(delta(1)) * t2;
+    axis.direction = (a + static_cast<float>(delta(2)) * t1 + static_cast<float>(delta(3)) * t2).normalized();
+    axis.radius += static_cast<float>(delta(4));
+    return true;
+}
+
+void CylinderFitter::finish(const pcl::PointCloud<pcl::PointXYZ> &cloud, CylinderAxis &axis) const
+{
+    // Extent along the axis, then move the axis point level with the centroid
+    const Eigen::Vector3f a = axis.direction;
+    const size_t n = cloud.points.size();
+    Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+    float low = std::numeric_limits<float>::max();
+    float high = -std::numeric_limits<float>::max();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const Eigen::Vector3f v = cloud.points[i].getVector3fMap() - axis.point;
+        const float along = a.dot(v);
+        const float r = (v - a * along).norm() - axis.radius;
+        centroid += cloud.points[i].getVector3fMap();
+        low = std::min(low, along);
+        high = std::max(high, along);
+        sum += r * r;
+    }
+    centroid /= static_cast<float>(n);
+
+    axis.start = axis.point + a * low;
+    axis.end = axis.point + a * high;
+    axis.point += a * a.dot(centroid - axis.point);
+    axis.rms = static_cast<float>(sqrt(sum / n));
+    axis.valid = axis.radius > 0.0f && axis.radius <= config_.maxRadius && axis.direction.allFinite();
+}
+
+void CylinderFitter::inliers(const pcl::PointCloud<pcl::PointXYZ> &cloud, const CylinderAxis &axis, float distance,
+                             std::vector<int> &indices) const
+{
+    indices.clear();
+    const Eigen::Vector3f &a = axis.direction;
+    for (size_t i = 0; i < cloud.points.size(); i++)
+    {
+        const Eigen::Vector3f v = cloud.points[i].getVector3fMap() - axis.point;
+        if (fabs((v - a * a.dot(v)).norm() - axis.radius) <= distance)
+        {
+            indices.push_back(static_cast<int>(i));
+        }
+    }
+}
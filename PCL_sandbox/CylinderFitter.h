@@ -0,0 +1,67 @@
+#ifndef CYLINDER_FITTER_H
+#define CYLINDER_FITTER_H
+
+#include <vector>
+#include <Eigen/Core>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/ModelCoefficients.h>
+
+// Axis of a leg cluster as a cylinder
+struct CylinderAxis
+{
+    bool valid;
+    Eigen::Vector3f point;     // on the axis, level with the cluster centroid
+    Eigen::Vector3f direction; // unit, from start to end
+    float radius;
+    Eigen::Vector3f start;     // axis at the ends of the cluster
+    Eigen::Vector3f end;
+    float rms;                 // of the point-to-surface distances
+
+    // Same layout as SACMODEL_CYLINDER: point, direction, radius
+    void toCoefficients(pcl::ModelCoefficients &coefficients) const;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// Cylinder fit for a segmented leg, without sampling. The axis starts as the
+// major PCA direction through the centroid and a fixed number of Gauss-Newton
+// steps then minimises the point-to-surface distance, plus the component of
+// each normal along the axis, so the runtime does not depend on luck.
+// Residuals beyond huberDistance are down-weighted.
+class CylinderFitter
+{
+public:
+    struct Config
+    {
+        Config();
+
+        int iterations;      // Gauss-Newton steps
+        float normalWeight;  // metres per unit of normal-axis cosine
+        float huberDistance; // residuals (m) above this count linearly
+        float maxRadius;     // fits with a larger radius are invalid (m)
+    };
+
+    CylinderFitter();
+    explicit CylinderFitter(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+
+    // normals may be empty, then only the distances are used
+    CylinderAxis fit(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals);
+
+    // Points within distance of the fitted surface
+    void inliers(const pcl::PointCloud<pcl::PointXYZ> &cloud, const CylinderAxis &axis, float distance,
+                 std::vector<int> &indices) const;
+
+private:
+    void initialise(const pcl::PointCloud<pcl::PointXYZ> &cloud, CylinderAxis &axis) const;
+    bool step(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+              CylinderAxis &axis) const;
+    void finish(const pcl::PointCloud<pcl::PointXYZ> &cloud, CylinderAxis &axis) const;
+
+    Config config_;
+};
+
+#endif
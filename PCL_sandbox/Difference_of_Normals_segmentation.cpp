@@ -4,129 +4,114 @@
  *
  * @author Yani Ioannou
  * @date 2012-09-24
+ *
+ * Runs as a node on the live Kinect2 stream. The normals are kept by
+ * DonStage between frames, so only the parts of the scene that moved are
+ * estimated again.
  */
 #include <string>
+#include <sstream>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <pcl_conversions/pcl_conversions.h>
 
 #include <pcl/point_types.h>
-#include <pcl/io/pcd_io.h>
-#include <pcl/search/organized.h>
+#include <pcl/common/io.h>
 #include <pcl/search/kdtree.h>
-#include <pcl/features/normal_3d_omp.h>
 #include <pcl/filters/conditional_removal.h>
 #include <pcl/segmentation/extract_clusters.h>
 
-#include <pcl/features/don.h>
+#include "DonStage.h"
 
 using namespace pcl;
 using namespace std;
 
-int
-main (int argc, char *argv[])
-{
-  ///The smallest scale to use in the DoN filter.
-  double scale1;
+ros::Publisher pub;
+DonStage don_stage;
 
-  ///The largest scale to use in the DoN filter.
-  double scale2;
+///The minimum DoN magnitude to threshold by
+double threshold;
 
-  ///The minimum DoN magnitude to threshold by
-  double threshold;
+///segment scene into clusters with given distance tolerance using euclidean clustering
+double segradius;
 
-  ///segment scene into clusters with given distance tolerance using euclidean clustering
-  double segradius;
+// Buffers reused between frames
+pcl::PointCloud<PointXYZ>::Ptr cloud (new pcl::PointCloud<PointXYZ>);
+PointCloud<PointNormal>::Ptr doncloud (new pcl::PointCloud<PointNormal>);
+pcl::PointCloud<PointNormal>::Ptr doncloud_filtered (new pcl::PointCloud<PointNormal>);
+pcl::ConditionalRemoval<PointNormal> condrem;
+pcl::search::KdTree<PointNormal>::Ptr segtree (new pcl::search::KdTree<PointNormal>);
 
-  if (argc < 6)
-  {
-    cerr << "usage: " << argv[0] << " inputfile smallscale largescale threshold segradius" << endl;
-    exit (EXIT_FAILURE);
-  }
+void
+callBack (const sensor_msgs::PointCloud2ConstPtr& input)
+{
+  pcl::fromROSMsg (*input, *cloud);
 
-  /// the file to read from.
-  string infile = argv[1];
-  /// small scale
-  istringstream (argv[2]) >> scale1;
-  /// large scale
-  istringstream (argv[3]) >> scale2;
-  istringstream (argv[4]) >> threshold;   // threshold for DoN magnitude
-  istringstream (argv[5]) >> segradius;   // threshold for radius segmentation
-
-  // Load cloud in blob format
-  pcl::PCLPointCloud2 blob;
-  pcl::io::loadPCDFile (infile.c_str (), blob);
-  pcl::PointCloud<PointXYZRGB>::Ptr cloud (new pcl::PointCloud<PointXYZRGB>);
-  pcl::fromPCLPointCloud2 (blob, *cloud);
-
-  // Create a search tree, use KDTreee for non-organized data.
-  pcl::search::Search<PointXYZRGB>::Ptr tree;
-  if (cloud->isOrganized ())
-  {
-    tree.reset (new pcl::search::OrganizedNeighbor<PointXYZRGB> ());
-  }
-  else
-  {
-    tree.reset (new pcl::search::KdTree<PointXYZRGB> (false));
-  }
+  // Compute DoN, reusing the normals of pixels that did not move
+  don_stage.compute (cloud, *doncloud);
 
-  // Set the input pointcloud for the search tree
-  tree->setInputCloud (cloud);
+  // Filter by magnitude
+  condrem.setInputCloud (doncloud);
+  condrem.filter (*doncloud_filtered);
 
-  if (scale1 >= scale2)
+  std::vector<pcl::PointIndices> cluster_indices;
+  if (!doncloud_filtered->points.empty ())
   {
-    cerr << "Error: Large scale must be > small scale!" << endl;
-    exit (EXIT_FAILURE);
+    segtree->setInputCloud (doncloud_filtered);
+
+    pcl::EuclideanClusterExtraction<PointNormal> ec;
+    ec.setClusterTolerance (segradius);
+    ec.setMinClusterSize (50);
+    ec.setMaxClusterSize (100000);
+    ec.setSearchMethod (segtree);
+    ec.setInputCloud (doncloud_filtered);
+    ec.extract (cluster_indices);
   }
 
-  // Compute normals using both small and large scales at each point
-  pcl::NormalEstimationOMP<PointXYZRGB, PointNormal> ne;
-  ne.setInputCloud (cloud);
-  ne.setSearchMethod (tree);
-
-  /**
-   * NOTE: setting viewpoint is very important, so that we can ensure
-   * normals are all pointed in the same direction!
-   */
-  ne.setViewPoint (std::numeric_limits<float>::max (), std::numeric_limits<float>::max (), std::numeric_limits<float>::max ());
-
-  // calculate normals with the small scale
-  cout << "Calculating normals for scale..." << scale1 << endl;
-  pcl::PointCloud<PointNormal>::Ptr normals_small_scale (new pcl::PointCloud<PointNormal>);
+  ROS_DEBUG ("DoN: %lu points recomputed, %lu above threshold, %lu clusters",
+             (unsigned long) don_stage.recomputedCount (), (unsigned long) doncloud_filtered->points.size (),
+             (unsigned long) cluster_indices.size ());
 
-  ne.setRadiusSearch (scale1);
-  ne.compute (*normals_small_scale);
-
-  // calculate normals with the large scale
-  cout << "Calculating normals for scale..." << scale2 << endl;
-  pcl::PointCloud<PointNormal>::Ptr normals_large_scale (new pcl::PointCloud<PointNormal>);
-
-  ne.setRadiusSearch (scale2);
-  ne.compute (*normals_large_scale);
+  // Clusters come out largest first, publish that one
+  pcl::PointCloud<PointNormal> cloud_cluster_don;
+  if (!cluster_indices.empty ())
+  {
+    pcl::copyPointCloud (*doncloud_filtered, cluster_indices[0], cloud_cluster_don);
+  }
+  cloud_cluster_don.header = doncloud->header;
 
-  // Create output cloud for DoN results
-  PointCloud<PointNormal>::Ptr doncloud (new pcl::PointCloud<PointNormal>);
-  copyPointCloud<PointXYZRGB, PointNormal>(*cloud, *doncloud);
+  sensor_msgs::PointCloud2 output;
+  pcl::toROSMsg (cloud_cluster_don, output);
+  pub.publish (output);
+}
 
-  cout << "Calculating DoN... " << endl;
-  // Create DoN operator
-  pcl::DifferenceOfNormalsEstimation<PointXYZRGB, PointNormal, PointNormal> don;
-  don.setInputCloud (cloud);
-  don.setNormalScaleLarge (normals_large_scale);
-  don.setNormalScaleSmall (normals_small_scale);
+int
+main (int argc, char *argv[])
+{
+  ros::init (argc, argv, "don_segmentation");
+  ros::NodeHandle nh;
 
-  if (!don.initCompute ())
+  if (argc < 5)
   {
-    std::cerr << "Error: Could not initialize DoN feature operator" << std::endl;
+    cerr << "usage: " << argv[0] << " smallscale largescale threshold segradius" << endl;
     exit (EXIT_FAILURE);
   }
 
-  // Compute DoN
-  don.computeFeature (*doncloud);
-
-  // Save DoN features
-  pcl::PCDWriter writer;
-  writer.write<pcl::PointNormal> ("don.pcd", *doncloud, false); 
+  DonStage::Config config;
+  /// small scale
+  istringstream (argv[1]) >> config.smallScale;
+  /// large scale
+  istringstream (argv[2]) >> config.largeScale;
+  istringstream (argv[3]) >> threshold;   // threshold for DoN magnitude
+  istringstream (argv[4]) >> segradius;   // threshold for radius segmentation
 
-  // Filter by magnitude
-  cout << "Filtering out DoN mag <= " << threshold << "..." << endl;
+  if (config.smallScale >= config.largeScale)
+  {
+    cerr << "Error: Large scale must be > small scale!" << endl;
+    exit (EXIT_FAILURE);
+  }
+  don_stage.configure (config);
 
   // Build the condition for filtering
   pcl::ConditionOr<PointNormal>::Ptr range_cond (
@@ -135,57 +120,15 @@ main (int argc, char *argv[])
   range_cond->addComparison (pcl::FieldComparison<PointNormal>::ConstPtr (
                                new pcl::FieldComparison<PointNormal> ("curvature", pcl::ComparisonOps::GT, threshold))
                              );
-  // Build the filter
-  pcl::ConditionalRemoval<PointNormal> condrem;
   condrem.setCondition (range_cond);
-  condrem.setInputCloud (doncloud);
-
-  pcl::PointCloud<PointNormal>::Ptr doncloud_filtered (new pcl::PointCloud<PointNormal>);
-
-  // Apply filter
-  condrem.filter (*doncloud_filtered);
 
-  doncloud = doncloud_filtered;
+  // Create a ROS subscriber for the input point cloud
+  ros::Subscriber sub = nh.subscribe ("/kinect2/sd/points", 1, callBack);
 
-  // Save filtered output
-  std::cout << "Filtered Pointcloud: " << doncloud->points.size () << " data points." << std::endl;
-
-  writer.write<pcl::PointNormal> ("don_filtered.pcd", *doncloud, false); 
-
-  // Filter by magnitude
-  cout << "Clustering using EuclideanClusterExtraction with tolerance <= " << segradius << "..." << endl;
+  // Largest DoN cluster of every frame
+  pub = nh.advertise<sensor_msgs::PointCloud2> ("/don/cluster", 1);
 
-  pcl::search::KdTree<PointNormal>::Ptr segtree (new pcl::search::KdTree<PointNormal>);
-  segtree->setInputCloud (doncloud);
+  ros::spin ();
 
-  std::vector<pcl::PointIndices> cluster_indices;
-  pcl::EuclideanClusterExtraction<PointNormal> ec;
-
-  ec.setClusterTolerance (segradius);
-  ec.setMinClusterSize (50);
-  ec.setMaxClusterSize (100000);
-  ec.setSearchMethod (segtree);
-  ec.setInputCloud (doncloud);
-  ec.extract (cluster_indices);
-
-  int j = 0;
-  for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin (); it != cluster_indices.end (); ++it, j++)
-  {
-    pcl::PointCloud<PointNormal>::Ptr cloud_cluster_don (new pcl::PointCloud<PointNormal>);
-    for (std::vector<int>::const_iterator pit = it->indices.begin (); pit != it->indices.end (); ++pit)
-    {
-      cloud_cluster_don->points.push_back (doncloud->points[*pit]);
-    }
-
-    cloud_cluster_don->width = int (cloud_cluster_don->points.size ());
-    cloud_cluster_don->height = 1;
-    cloud_cluster_don->is_dense = true;
-
-    //Save cluster
-    cout << "PointCloud representing the Cluster: " << cloud_cluster_don->points.size () << " data points." << std::endl;
-    stringstream ss;
-    ss << "don_cluster_" << j << ".pcd";
-    writer.write<pcl::PointNormal> (ss.str (), *cloud_cluster_don, false);
-  }
+  return (0);
 }
-
@@ -0,0 +1,308 @@
+#include "DonStage.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <functional>
+#include <thread>
+#include <pcl/common/point_tests.h>
+#include <pcl/features/normal_3d.h>
+
+DonStage::Config::Config() :
+    smallScale(0.01f),
+    largeScale(0.05f),
+    depthTolerance(0.005f),
+    depthNoise(0.01f),
+    minChanged(3),
+    focalLength(365.5f),
+    minDepth(0.5f),
+    threads(0)
+{}
+
+DonStage::DonStage() :
+    organized_search_(new pcl::search::OrganizedNeighbor<pcl::PointXYZ>),
+    tree_search_(new pcl::search::KdTree<pcl::PointXYZ>(false)),
+    width_(0)
+{
+    // Setting the viewpoint is very important, so that the normals of both
+    // scales are all pointed in the same direction
+    setViewPoint(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max());
+    configure(Config());
+}
+
+DonStage::DonStage(const Config &config) :
+    organized_search_(new pcl::search::OrganizedNeighbor<pcl::PointXYZ>),
+    tree_search_(new pcl::search::KdTree<pcl::PointXYZ>(false)),
+    width_(0)
+{
+    setViewPoint(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max());
+    configure(config);
+}
+
+void DonStage::configure(const Config &config)
+{
+    config_ = config;
+    if (config_.threads == 0)
+    {
+        config_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // A changed pixel reaches this far into the image at each scale, about
+    // 8 px and 37 px at the closest surface
+    margin_small_ = static_cast<int>(ceil(config_.smallScale * config_.focalLength / config_.minDepth));
+    margin_large_ = static_cast<int>(ceil(config_.largeScale * config_.focalLength / config_.minDepth));
+    reset();
+}
+
+void DonStage::setViewPoint(float vpx, float vpy, float vpz)
+{
+    vpx_ = vpx;
+    vpy_ = vpy;
+    vpz_ = vpz;
+    reset();
+}
+
+void DonStage::reset()
+{
+    depth_.clear();
+    width_ = 0;
+}
+
+void DonStage::compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, pcl::PointCloud<pcl::PointNormal> &don)
+{
+    const size_t n = cloud->points.size();
+    const bool organized = cloud->isOrganized();
+    const bool reuse = organized && depth_.size() == n && width_ == cloud->width;
+    dirty_small_.clear();
+    dirty_large_.clear();
+    if (reuse)
+    {
+        // Every pixel whose neighbourhood contains a changed pixel has to be
+        // redone, and the neighbourhood depends on the scale
+        findChanged(*cloud);
+        dilate(static_cast<int>(cloud->width), static_cast<int>(cloud->height), margin_small_, dirty_small_);
+        dilate(static_cast<int>(cloud->width), static_cast<int>(cloud->height), margin_large_, dirty_large_);
+    }
+    else
+    {
+        normals_small_.points.resize(n);
+        normals_large_.points.resize(n);
+        depth_.assign(n, std::numeric_limits<float>::quiet_NaN());
+        width_ = cloud->width;
+        for (size_t i = 0; i < n; ++i)
+        {
+            dirty_small_.push_back(static_cast<int>(i));
+        }
+        dirty_large_ = dirty_small_;
+    }
+
+    if (organized)
+    {
+        search_ = organized_search_;
+    }
+    else
+    {
+        search_ = tree_search_;
+    }
+    search_->setInputCloud(cloud);
+
+    computeScale(*cloud, config_.largeScale, dirty_large_, &normals_large_);
+    computeScale(*cloud, config_.smallScale, dirty_small_, &normals_small_);
+
+    // Both normals of these pixels are up to date. The ones only in the large
+    // list did not change themselves, so they keep comparing to their old depth
+    // and small drifts still add up to a change.
+    for (size_t k = 0; k < dirty_small_.size(); ++k)
+    {
+        depth_[dirty_small_[k]] = cloud->points[dirty_small_[k]].z;
+    }
+
+    don.points.resize(n);
+    don.header = cloud->header;
+    don.width = cloud->width;
+    don.height = cloud->height;
+    don.is_dense = true;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    for (size_t i = 0; i < n; ++i)
+    {
+        pcl::PointNormal &d = don.points[i];
+        d.x = cloud->points[i].x;
+        d.y = cloud->points[i].y;
+        d.z = cloud->points[i].z;
+        if (pcl_isfinite(d.z))
+        {
+            d.getNormalVector3fMap() = (normals_small_.points[i].getNormalVector3fMap()
+                                      - normals_large_.points[i].getNormalVector3fMap()) / 2.0f;
+            d.curvature = d.getNormalVector3fMap().norm();
+        }
+        else
+        {
+            // A single pixel that dropped out is not recomputed, do not keep its old normals
+            d.normal_x = d.normal_y = d.normal_z = d.curvature = nan;
+        }
+        if (!pcl_isfinite(d.curvature))
+        {
+            don.is_dense = false;
+        }
+    }
+}
+
+void DonStage::findChanged(const pcl::PointCloud<pcl::PointXYZ> &cloud)
+{
+    // A pixel moved if its depth changed by more than the noise at that depth,
+    // or it appeared or vanished
+    const size_t n = cloud.points.size();
+    raw_.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float z = cloud.points[i].z;
+        const float old = depth_[i];
+        const bool valid = pcl_isfinite(z);
+        const bool was_valid = pcl_isfinite(old);
+        if (valid != was_valid)
+        {
+            raw_[i] = 1;
+        }
+        else if (valid)
+        {
+            const float tolerance = config_.depthTolerance + config_.depthNoise * old * old;
+            raw_[i] = fabs(z - old) > tolerance;
+        }
+        else
+        {
+            raw_[i] = 0;
+        }
+    }
+
+    // Kinect2 noise and the flicker at object edges hit single pixels; a real
+    // change covers a patch. Keep pixels with at least minChanged moved
+    // pixels in their 3x3 neighbourhood.
+    const int width = static_cast<int>(cloud.width);
+    const int height = static_cast<int>(cloud.height);
+    changed_.resize(n);
+    for (int y = 0; y < height; ++y)
+    {
+        const int y0 = std::max(0, y - 1);
+        const int y1 = std::min(height - 1, y + 1);
+        for (int x = 0; x < width; ++x)
+        {
+            const int x0 = std::max(0, x - 1);
+            const int x1 = std::min(width - 1, x + 1);
+            int count = 0;
+            for (int v = y0; v <= y1; ++v)
+            {
+                const char *row = &raw_[v * width];
+                for (int u = x0; u <= x1; ++u)
+                {
+                    count += row[u];
+                }
+            }
+            changed_[y * width + x] = count >= config_.minChanged;
+        }
+    }
+}
+
+void DonStage::dilate(int width, int height, int margin, std::vector<int> &dirty)
+{
+    // Square dilation of changed_ by margin, one pass along the rows and one
+    // along the columns, each keeping a running count over the window
+    const int m = margin;
+    grown_.resize(changed_.size());
+    dilated_.resize(changed_.size());
+    for (int y = 0; y < height; ++y)
+    {
+        const char *in = &changed_[y * width];
+        char *out = &grown_[y * width];
+        int count = 0;
+        for (int x = 0; x < m && x < width; ++x)
+        {
+            count += in[x];
+        }
+        for (int x = 0; x < width; ++x)
+        {
+            if (x + m < width)
+            {
+                count += in[x + m];
+            }
+            if (x - m - 1 >= 0)
+            {
+                count -= in[x - m - 1];
+            }
+            out[x] = count > 0;
+        }
+    }
+    for (int x = 0; x < width; ++x)
+    {
+        int count = 0;
+        for (int y = 0; y < m && y < height; ++y)
+        {
+            count += grown_[y * width + x];
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            if (y + m < height)
+            {
+                count += grown_[(y + m) * width + x];
+            }
+            if (y - m - 1 >= 0)
+            {
+                count -= grown_[(y - m - 1) * width + x];
+            }
+            dilated_[y * width + x] = count > 0;
+        }
+    }
+
+    const size_t n = dilated_.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (dilated_[i])
+        {
+            dirty.push_back(static_cast<int>(i));
+        }
+    }
+}
+
+void DonStage::computeScale(const pcl::PointCloud<pcl::PointXYZ> &cloud, float scale, const std::vector<int> &dirty,
+                            pcl::PointCloud<pcl::Normal> *normals) const
+{
+    // The searches only read the cloud and the search structure, and every
+    // point writes its own normal
+    const size_t n = dirty.size();
+    const size_t nr_blocks = std::max<size_t>(1, std::min<size_t>(config_.threads, n));
+    std::vector<std::thread> workers;
+    for (size_t b = 1; b < nr_blocks; ++b)
+    {
+        workers.push_back(std::thread(&DonStage::computeNormals, this, std::cref(cloud), scale, std::cref(dirty),
+                                      b * n / nr_blocks, (b + 1) * n / nr_blocks, normals));
+    }
+    computeNormals(cloud, scale, dirty, 0, n / nr_blocks, normals);
+    for (size_t t = 0; t < workers.size(); ++t)
+    {
+        workers[t].join();
+    }
+}
+
+void DonStage::computeNormals(const pcl::PointCloud<pcl::PointXYZ> &cloud, float scale, const std::vector<int> &dirty,
+                              size_t first, size_t last, pcl::PointCloud<pcl::Normal> *normals) const
+{
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    for (size_t k = first; k < last; ++k)
+    {
+        const int i = dirty[k];
+        const pcl::PointXYZ &p = cloud.points[i];
+        pcl::Normal &n = normals->points[i];
+        Eigen::Vector4f plane;
+        if (!pcl::isFinite(p) || search_->radiusSearch(p, scale, nn_indices, nn_dists) < 3 ||
+            !pcl::computePointNormal(cloud, nn_indices, plane, n.curvature))
+        {
+            n.normal_x = n.normal_y = n.normal_z = n.curvature = std::numeric_limits<float>::quiet_NaN();
+            continue;
+        }
+        pcl::flipNormalTowardsViewpoint(p, vpx_, vpy_, vpz_, plane);
+        n.normal_x = plane[0];
+        n.normal_y = plane[1];
+        n.normal_z = plane[2];
+    }
+}
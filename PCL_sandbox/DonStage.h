@@ -0,0 +1,86 @@
+#ifndef DON_STAGE_H
+#define DON_STAGE_H
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/search.h>
+#include <pcl/search/organized.h>
+#include <pcl/search/kdtree.h>
+
+// Difference of Normals for a stream of frames. The small- and large-scale
+// normals are kept between frames: on an organized frame a pixel counts as
+// changed when its depth moved by more than the sensor noise since its
+// normals were computed, and enough of its 3x3 neighbours changed too, so
+// single flickering pixels do not trigger work. The changed pixels are grown
+// by each scale's own window and only those are estimated again. The points
+// of each scale are split over threads. Unorganized clouds are always
+// computed in full.
+class DonStage
+{
+public:
+    struct Config
+    {
+        Config();
+
+        float smallScale;     // radius (m) of the small-scale normals
+        float largeScale;     // radius (m) of the large-scale normals
+        float depthTolerance; // depth change (m) that counts as a changed pixel...
+        float depthNoise;     // ...plus this times depth^2 (1/m), Kinect2 noise grows with depth
+        int minChanged;       // changed pixels needed in a 3x3 neighbourhood, 1 to keep single pixels
+        float focalLength;    // depth camera focal length (px)
+        float minDepth;       // closest expected surface (m), sizes the pixel windows
+        unsigned int threads; // worker threads per scale, 0 for one per core
+    };
+
+    DonStage();
+    explicit DonStage(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+    void setViewPoint(float vpx, float vpy, float vpz);
+
+    // Forget the previous frame, so the next one is computed in full
+    void reset();
+
+    // Output has the layout of the input: the point, the DoN vector as the
+    // normal and its magnitude as the curvature. Invalid points are NaN.
+    void compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, pcl::PointCloud<pcl::PointNormal> &don);
+
+    // Points whose large-scale normals were estimated for the last frame
+    // (the small-scale ones are a subset of them)
+    size_t recomputedCount() const { return dirty_large_.size(); }
+
+private:
+    void findChanged(const pcl::PointCloud<pcl::PointXYZ> &cloud);
+    void dilate(int width, int height, int margin, std::vector<int> &dirty);
+    void computeScale(const pcl::PointCloud<pcl::PointXYZ> &cloud, float scale, const std::vector<int> &dirty,
+                      pcl::PointCloud<pcl::Normal> *normals) const;
+    void computeNormals(const pcl::PointCloud<pcl::PointXYZ> &cloud, float scale, const std::vector<int> &dirty,
+                        size_t first, size_t last, pcl::PointCloud<pcl::Normal> *normals) const;
+
+    Config config_;
+    int margin_small_; // pixels a changed pixel can reach at smallScale
+    int margin_large_; // and at largeScale
+    float vpx_, vpy_, vpz_;
+
+    pcl::search::OrganizedNeighbor<pcl::PointXYZ>::Ptr organized_search_;
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree_search_;
+    pcl::search::Search<pcl::PointXYZ>::Ptr search_;
+
+    // Kept between frames
+    pcl::PointCloud<pcl::Normal> normals_small_;
+    pcl::PointCloud<pcl::Normal> normals_large_;
+    std::vector<float> depth_; // depth each pixel had when its normals were computed
+    unsigned int width_;
+
+    // Per-frame buffers
+    std::vector<char> raw_;     // depth test alone
+    std::vector<char> changed_; // after the neighbourhood count
+    std::vector<char> grown_;   // dilation scratch, rows then columns
+    std::vector<char> dilated_;
+    std::vector<int> dirty_small_;
+    std::vector<int> dirty_large_;
+};
+
+#endif
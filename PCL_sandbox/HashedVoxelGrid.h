@@ -0,0 +1,220 @@
+#ifndef HASHED_VOXEL_GRID_H
+#define HASHED_VOXEL_GRID_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/point_tests.h>
+
+// Voxel grid downsampling with the same output as pcl::VoxelGrid (one point
+// per occupied voxel at the centroid of its points), but the voxels are found
+// through an open-addressing hash table keyed by the voxel coordinate instead
+// of a dense index over the bounding box. pcl::VoxelGrid gives up once the box
+// has more than INT_MAX cells, which a 1mm leaf over our ROI already reaches.
+// Here every axis has 2^21 cells around the origin, so a 1mm leaf covers
+// +-1km. Points outside that range are dropped.
+//
+// The table is sized for twice the largest cloud seen and kept between
+// frames; only the used slots are cleared afterwards. The hashing runs over
+// blocks of points in parallel, the centroid sums in one pass after it.
+// Header only, so the Visual Studio sources can include it directly.
+template <typename PointT>
+class HashedVoxelGrid
+{
+public:
+    typedef pcl::PointCloud<PointT> Cloud;
+
+    HashedVoxelGrid() :
+        leaf_(0.005f),
+        threads_(1),
+        bits_(0)
+    {}
+
+    void setLeafSize(float leaf) { leaf_ = leaf; }
+    float getLeafSize() const { return leaf_; }
+
+    // Split the hashing over this many threads, 0 for one per core
+    void setNumberOfThreads(unsigned int threads)
+    {
+        threads_ = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Grow the table up front for clouds of up to max_points points
+    void reserve(size_t max_points)
+    {
+        if (max_points * 2 <= capacity())
+        {
+            return;
+        }
+        bits_ = 4;
+        while ((size_t(1) << bits_) < max_points * 2)
+        {
+            ++bits_;
+        }
+        std::vector<std::atomic<uint64_t> > keys(size_t(1) << bits_);
+        for (size_t s = 0; s < keys.size(); ++s)
+        {
+            keys[s].store(EMPTY, std::memory_order_relaxed);
+        }
+        keys_.swap(keys);
+        voxel_.assign(keys_.size(), -1);
+        point_slot_.reserve(max_points);
+        first_.reserve(max_points);
+        sums_.reserve(max_points * 3);
+        counts_.reserve(max_points);
+        used_.reserve(max_points);
+    }
+
+    void filter(const Cloud &cloud, Cloud &output)
+    {
+        filterPoints(cloud, 0, cloud.points.size(), output);
+    }
+
+    // Only the given points of the cloud
+    void filter(const Cloud &cloud, const std::vector<int> &indices, Cloud &output)
+    {
+        filterPoints(cloud, &indices, indices.size(), output);
+    }
+
+    size_t capacity() const { return keys_.size(); }
+
+private:
+    static const uint64_t EMPTY = ~uint64_t(0);
+    static const int AXIS_BITS = 21;
+    static const int64_t AXIS_OFFSET = int64_t(1) << (AXIS_BITS - 1);
+
+    void filterPoints(const Cloud &cloud, const std::vector<int> *indices, size_t n, Cloud &output)
+    {
+        reserve(n);
+        point_slot_.resize(n);
+
+        // Claim a slot for the voxel of every point
+        const size_t nr_blocks = std::max<size_t>(1, std::min<size_t>(threads_, n));
+        std::vector<std::thread> workers;
+        for (size_t b = 1; b < nr_blocks; ++b)
+        {
+            workers.push_back(std::thread(&HashedVoxelGrid::hashBlock, this, &cloud, indices,
+                                          b * n / nr_blocks, (b + 1) * n / nr_blocks));
+        }
+        hashBlock(&cloud, indices, 0, n / nr_blocks);
+        for (size_t t = 0; t < workers.size(); ++t)
+        {
+            workers[t].join();
+        }
+
+        // Number the voxels in order of their first point and sum their points
+        first_.clear();
+        sums_.clear();
+        counts_.clear();
+        used_.clear();
+        for (size_t i = 0; i < n; ++i)
+        {
+            const int64_t slot = point_slot_[i];
+            if (slot < 0)
+            {
+                continue;
+            }
+            const PointT &p = cloud.points[indices ? (*indices)[i] : i];
+            int &voxel = voxel_[slot];
+            if (voxel < 0)
+            {
+                voxel = static_cast<int>(counts_.size());
+                used_.push_back(slot);
+                first_.push_back(indices ? (*indices)[i] : static_cast<int>(i));
+                sums_.push_back(0.0f);
+                sums_.push_back(0.0f);
+                sums_.push_back(0.0f);
+                counts_.push_back(0);
+            }
+            sums_[3 * voxel] += p.x;
+            sums_[3 * voxel + 1] += p.y;
+            sums_[3 * voxel + 2] += p.z;
+            ++counts_[voxel];
+        }
+
+        // The other fields are taken from the first point of each voxel
+        const size_t nr_voxels = counts_.size();
+        output.points.resize(nr_voxels);
+        for (size_t v = 0; v < nr_voxels; ++v)
+        {
+            PointT &q = output.points[v];
+            q = cloud.points[first_[v]];
+            const float inv = 1.0f / counts_[v];
+            q.x = sums_[3 * v] * inv;
+            q.y = sums_[3 * v + 1] * inv;
+            q.z = sums_[3 * v + 2] * inv;
+        }
+        output.header = cloud.header;
+        output.width = static_cast<uint32_t>(nr_voxels);
+        output.height = 1;
+        output.is_dense = true;
+
+        for (size_t u = 0; u < used_.size(); ++u)
+        {
+            keys_[used_[u]].store(EMPTY, std::memory_order_relaxed);
+            voxel_[used_[u]] = -1;
+        }
+    }
+
+    void hashBlock(const Cloud *cloud, const std::vector<int> *indices, size_t first, size_t last)
+    {
+        const float inv_leaf = 1.0f / leaf_;
+        const size_t mask = keys_.size() - 1;
+        for (size_t i = first; i < last; ++i)
+        {
+            point_slot_[i] = -1;
+            const PointT &p = cloud->points[indices ? (*indices)[i] : i];
+            if (!pcl::isFinite(p))
+            {
+                continue;
+            }
+            const int64_t vx = static_cast<int64_t>(std::floor(p.x * inv_leaf)) + AXIS_OFFSET;
+            const int64_t vy = static_cast<int64_t>(std::floor(p.y * inv_leaf)) + AXIS_OFFSET;
+            const int64_t vz = static_cast<int64_t>(std::floor(p.z * inv_leaf)) + AXIS_OFFSET;
+            const int64_t range = int64_t(1) << AXIS_BITS;
+            if (vx < 0 || vx >= range || vy < 0 || vy >= range || vz < 0 || vz >= range)
+            {
+                continue;
+            }
+            const uint64_t key = (uint64_t(vx) << (2 * AXIS_BITS)) | (uint64_t(vy) << AXIS_BITS) | uint64_t(vz);
+
+            // Linear probing from the mixed key. The table has at least twice
+            // as many slots as points, so there is always an empty one.
+            size_t slot = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - bits_));
+            for (;;)
+            {
+                uint64_t current = keys_[slot].load(std::memory_order_relaxed);
+                if (current == EMPTY &&
+                    keys_[slot].compare_exchange_strong(current, key, std::memory_order_relaxed))
+                {
+                    break;
+                }
+                if (current == key)
+                {
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            point_slot_[i] = static_cast<int64_t>(slot);
+        }
+    }
+
+    float leaf_;
+    unsigned int threads_;
+    int bits_; // log2 of the table size
+
+    std::vector<std::atomic<uint64_t> > keys_; // packed voxel coordinate per slot
+    std::vector<int> voxel_;                   // output point of each slot, -1 if unused this frame
+    std::vector<int64_t> point_slot_;          // slot of every input point, -1 if dropped
+    std::vector<int> first_;                   // first input point of each voxel
+    std::vector<float> sums_;                  // x, y, z sums per voxel
+    std::vector<int> counts_;
+    std::vector<int64_t> used_;                // slots to clear after the frame
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "KinectRangeImage.h"
+
+#include <math.h>
+#include <limits>
+#include <pcl/common/point_tests.h>
+
+KinectRangeImage::Intrinsics::Intrinsics() :
+    fx(365.5f),
+    fy(365.5f),
+    cx(256.0f),
+    cy(212.0f)
+{}
+
+KinectRangeImage::KinectRangeImage()
+{
+}
+
+bool KinectRangeImage::setFrame(const pcl::PointCloud<pcl::PointXYZ> &cloud)
+{
+    if (!cloud.isOrganized())
+    {
+        reset();
+        return false;
+    }
+
+    // Same set up as RangeImagePlanar::setDepthImage(), without the depth pass
+    width = cloud.width;
+    height = cloud.height;
+    is_dense = false;
+    header = cloud.header;
+    image_offset_x_ = image_offset_y_ = 0;
+    focal_length_x_ = intrinsics_.fx;
+    focal_length_y_ = intrinsics_.fy;
+    focal_length_x_reciprocal_ = 1.0f / focal_length_x_;
+    focal_length_y_reciprocal_ = 1.0f / focal_length_y_;
+    center_x_ = intrinsics_.cx;
+    center_y_ = intrinsics_.cy;
+    // One pixel at the image centre, NARF sizes its support windows from this
+    setAngularResolution(atan(focal_length_x_reciprocal_), atan(focal_length_y_reciprocal_));
+    to_world_system_.setIdentity();
+    to_range_image_system_.setIdentity();
+
+    // Resizing to the same frame size does not reallocate
+    points.resize(cloud.points.size());
+    for (size_t i = 0; i < cloud.points.size(); ++i)
+    {
+        const pcl::PointXYZ &p = cloud.points[i];
+        pcl::PointWithRange &r = points[i];
+        if (!pcl::isFinite(p))
+        {
+            r = unobserved_point;
+            continue;
+        }
+        r.x = p.x;
+        r.y = p.y;
+        r.z = p.z;
+        r.range = sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+    }
+    return true;
+}
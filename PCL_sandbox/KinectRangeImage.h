@@ -0,0 +1,40 @@
+#ifndef KINECT_RANGE_IMAGE_H
+#define KINECT_RANGE_IMAGE_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/range_image/range_image_planar.h>
+
+// Range image over an organized depth camera frame. The frame already is a
+// planar range image, so every pixel is taken over as it is: the point, its
+// range, and the camera intrinsics for the projection. Nothing is
+// reprojected or resampled as in RangeImage::createFromPointCloud(), and the
+// buffers are reused between frames. Usable wherever PCL takes a RangeImage,
+// e.g. for NARF keypoints and descriptors.
+class KinectRangeImage : public pcl::RangeImagePlanar
+{
+public:
+    typedef boost::shared_ptr<KinectRangeImage> Ptr;
+
+    struct Intrinsics
+    {
+        Intrinsics();
+
+        float fx, fy; // focal lengths (px)
+        float cx, cy; // principal point (px)
+    };
+
+    KinectRangeImage();
+
+    void setIntrinsics(const Intrinsics &intrinsics) { intrinsics_ = intrinsics; }
+    const Intrinsics &intrinsics() const { return intrinsics_; }
+
+    // Take over an organized frame in the camera frame (z forward). Returns
+    // false and leaves the image empty if the cloud is not organized.
+    bool setFrame(const pcl::PointCloud<pcl::PointXYZ> &cloud);
+
+private:
+    Intrinsics intrinsics_;
+};
+
+#endif
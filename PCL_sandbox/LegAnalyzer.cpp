@@ -0,0 +1,358 @@
+#include "LegAnalyzer.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <Eigen/Dense>
+
+namespace
+{
+inline float sqrDist(const pcl::PointXYZ &a, const pcl::PointXYZ &b)
+{
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return dx*dx + dy*dy + dz*dz;
+}
+}
+
+LegAnalyzer::Config::Config() :
+    tipDistance(0.14f),
+    neighbourGap(30),
+    tipWindow(20),
+    maxAngleDev(35.0f),
+    mergeFraction(40),
+    approachSteps(36)
+{}
+
+LegAnalyzer::LegAnalyzer() :
+    chosen_cross_(-1)
+{
+    configure(Config());
+}
+
+LegAnalyzer::LegAnalyzer(const Config &config) :
+    chosen_cross_(-1)
+{
+    configure(config);
+}
+
+void LegAnalyzer::configure(const Config &config)
+{
+    config_ = config;
+    // |angle - 90| < dev  <=>  |cos(angle)| < sin(dev), so no acos per line
+    cos_window_ = sin(config_.maxAngleDev * M_PI / 180.0);
+}
+
+void LegAnalyzer::reserve(size_t max_points)
+{
+    const size_t lines = max_points / 2;
+    cross_from_.reserve(lines);
+    cross_to_.reserve(lines);
+    width_.reserve(lines);
+    cross_valid_.reserve(lines);
+    valid_.reserve(lines);
+}
+
+int LegAnalyzer::indexGap(int a, int b, int n) const
+{
+    //Distance along the closed contour
+    int d = abs(a - b);
+    return std::min(d, n - d);
+}
+
+CutPose LegAnalyzer::process(const Contour &contour)
+{
+    CutPose out;
+    out.valid = false;
+    std::fill(out.pose, out.pose + 6, 0.0f);
+    out.tip = out.base = out.cut1 = out.cut2 = 0;
+    out.fixed1 = out.fixed2 = 0;
+    out.width = 0.0f;
+
+    cross_from_.clear();
+    cross_to_.clear();
+    width_.clear();
+    cross_valid_.clear();
+    valid_.clear();
+    chosen_cross_ = -1;
+
+    const int n = static_cast<int>(contour.points.size());
+    if (n < 2 * config_.neighbourGap + 2)
+    {
+        return out;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Longest line, then the thickness along the contour starting from one end
+    int idx1, idx2;
+    findLongestLine(contour, idx1, idx2);
+    buildThicknessProfile(contour, idx1);
+
+    // Make sure that idx1 is the narrow end
+    const size_t lines = width_.size();
+    float sum1 = 0.0f, sum2 = 0.0f;
+    for (size_t i = 0; i < lines / 2; i++)
+    {
+        sum1 += width_[i];
+    }
+    for (size_t i = lines / 2; i < lines; i++)
+    {
+        sum2 += width_[i];
+    }
+    if (sum1 / (lines / 2) >= sum2 / (lines - lines / 2))
+    {
+        std::swap(idx1, idx2);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Discriminate cross lines that are not roughly perpendicular to the leg
+    Eigen::Vector3f along = contour.points[idx2].getVector3fMap() - contour.points[idx1].getVector3fMap();
+    along.normalize();
+    for (size_t i = 0; i < lines; i++)
+    {
+        Eigen::Vector3f across = contour.points[cross_from_[i]].getVector3fMap()
+                               - contour.points[cross_to_[i]].getVector3fMap();
+        const float len = across.norm();
+        const bool ok = len > 0.0f && fabs(along.dot(across) / len) < cos_window_;
+        cross_valid_[i] = ok;
+        if (ok)
+        {
+            valid_.push_back(static_cast<int>(i));
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Combine the thinnest cross line with the fixed distance estimate
+    int point1, point2;
+    fixedDistanceCut(contour, idx1, idx2, point1, point2);
+    out.fixed1 = point1;
+    out.fixed2 = point2;
+
+    const int thinnest = findThinnestValid();
+    if (thinnest >= 0)
+    {
+        chosen_cross_ = valid_[thinnest];
+        const int from = cross_from_[chosen_cross_];
+        const int limit = n / config_.mergeFraction;
+        if (indexGap(from, point1, n) < limit || indexGap(from, point2, n) < limit)
+        {
+            point1 = cross_to_[chosen_cross_];
+            point2 = from;
+        }
+    }
+
+    out.tip = idx1;
+    out.base = idx2;
+    out.cut1 = point1;
+    out.cut2 = point2;
+    out.width = sqrt(sqrDist(contour.points[point1], contour.points[point2]));
+    out.valid = computePose(contour, out);
+    return out;
+}
+
+void LegAnalyzer::findLongestLine(const Contour &contour, int &idx1, int &idx2) const
+{
+    // Try out different pairs, looking for the longest distance between them.
+    // Squared distances are enough for the comparison.
+    const int n = static_cast<int>(contour.points.size());
+    const int exclude = n / 5; // exclude immediate neighbors
+    float longest = -1.0f;
+    idx1 = 0;
+    idx2 = 0;
+    for (int i = 0; i < n / 2; i++)
+    {
+        const pcl::PointXYZ &pi = contour.points[i];
+        for (int j = 0; j < n; j++)
+        {
+            if (abs(i - j) > exclude)
+            {
+                const float len = sqrDist(pi, contour.points[j]);
+                if (len > longest)
+                {
+                    longest = len;
+                    idx1 = i;
+                    idx2 = j;
+                }
+            }
+        }
+    }
+}
+
+void LegAnalyzer::buildThicknessProfile(const Contour &contour, int idx1)
+{
+    const int n = static_cast<int>(contour.points.size());
+    const int lines = n / 2;
+    cross_from_.resize(lines);
+    cross_to_.resize(lines);
+    width_.resize(lines);
+    cross_valid_.resize(lines);
+
+    for (int i = 0; i < lines; i++)
+    {
+        const int from = (idx1 + i) % n;
+        int to;
+        float width;
+        if (indexGap(from, idx1, n) < config_.tipWindow)
+        {
+            // Close to the tip the nearest opposite is the mirrored index
+            to = ((2 * idx1 - from) % n + n) % n;
+            width = sqrt(sqrDist(contour.points[from], contour.points[to]));
+        }
+        else
+        {
+            to = nearestOpposite(contour, from, width);
+        }
+        cross_from_[i] = from;
+        cross_to_[i] = to;
+        width_[i] = width;
+    }
+}
+
+int LegAnalyzer::nearestOpposite(const Contour &contour, int idx, float &dist) const
+{
+    const int n = static_cast<int>(contour.points.size());
+    const pcl::PointXYZ &p = contour.points[idx];
+    float shortest = std::numeric_limits<float>::max();
+    int best = idx;
+    for (int point = 0; point < n; point++)
+    {
+        if (indexGap(point, idx, n) > config_.neighbourGap)
+        {
+            const float len = sqrDist(p, contour.points[point]);
+            if (len < shortest)
+            {
+                shortest = len;
+                best = point;
+            }
+        }
+    }
+    dist = best == idx ? 0.0f : sqrt(shortest);
+    return best;
+}
+
+int LegAnalyzer::findThinnestValid() const
+{
+    // Local minimum of the valid widths, starting from the middle. After
+    // reaching a minimum, look a few steps further in both directions so
+    // small bumps in the contour do not stop the search.
+    const int count = static_cast<int>(valid_.size());
+    if (count == 0)
+    {
+        return -1;
+    }
+    const int check = std::max(1, count / 12);
+    int idx = count / 2;
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        for (;;)
+        {
+            if (idx > 0 && width_[valid_[idx - 1]] < width_[valid_[idx]])
+            {
+                idx--;
+            }
+            else if (idx + 1 < count && width_[valid_[idx + 1]] < width_[valid_[idx]])
+            {
+                idx++;
+            }
+            else
+            {
+                break;
+            }
+        }
+        for (int step = 1; step <= check && !moved; step++)
+        {
+            if (idx - step >= 0 && width_[valid_[idx - step]] < width_[valid_[idx]])
+            {
+                idx -= step;
+                moved = true;
+            }
+            else if (idx + step < count && width_[valid_[idx + step]] < width_[valid_[idx]])
+            {
+                idx += step;
+                moved = true;
+            }
+        }
+    }
+    return idx;
+}
+
+void LegAnalyzer::fixedDistanceCut(const Contour &contour, int start, int end, int &p1, int &p2) const
+{
+    // Point on the longest line tipDistance from the start. Unlike the old
+    // eighteen() it is not pushed onto the cloud.
+    const int n = static_cast<int>(contour.points.size());
+    const pcl::PointXYZ &s = contour.points[start];
+    const pcl::PointXYZ &e = contour.points[end];
+    const float len = sqrt(sqrDist(s, e));
+    const float t = len > 0.0f ? config_.tipDistance / len : 0.0f;
+    pcl::PointXYZ target;
+    target.x = s.x + (e.x - s.x) * t;
+    target.y = s.y + (e.y - s.y) * t;
+    target.z = s.z + (e.z - s.z) * t;
+
+    float shortest = std::numeric_limits<float>::max();
+    p1 = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const float d = sqrDist(contour.points[i], target);
+        if (d < shortest)
+        {
+            shortest = d;
+            p1 = i;
+        }
+    }
+    float width;
+    p2 = nearestOpposite(contour, p1, width);
+}
+
+bool LegAnalyzer::computePose(const Contour &contour, CutPose &out) const
+{
+    const Eigen::Vector3f start1 = contour.points[out.cut1].getVector3fMap();
+    const Eigen::Vector3f end1 = contour.points[out.cut2].getVector3fMap();
+    const Eigen::Vector3f start2 = contour.points[out.tip].getVector3fMap();
+    const Eigen::Vector3f end2 = contour.points[out.base].getVector3fMap();
+
+    // make the point indicating position
+    const Eigen::Vector3f position = end1 + (start1 - end1) / 2;
+    out.pose[0] = position(0);
+    out.pose[1] = position(1);
+    out.pose[2] = position(2);
+
+    const Eigen::Vector3f across = (end1 - start1).normalized(); //between sides of leg
+    const Eigen::Vector3f along = (end2 - start2).normalized();  //the longest line
+    Eigen::Vector3f rotvec = across.cross(along);                //rotated around planevec
+    if (rotvec.norm() < 1e-6f)
+    {
+        // The cut runs along the leg (or collapsed to a point), no orientation
+        return false;
+    }
+    rotvec.normalize();
+    const Eigen::Vector3f planevec = across.cross(rotvec).normalized();
+    const Eigen::Vector3f robvec = position.normalized();
+
+    // Test which rotation about planevec points best towards robvec. rotvec is
+    // perpendicular to planevec, so Rodrigue's formula reduces to two terms.
+    const float step = 2.0f * M_PI / config_.approachSteps;
+    const Eigen::Vector3f side = planevec.cross(rotvec);
+    float best = -2.0f;
+    Eigen::Vector3f chosen = rotvec;
+    for (int i = 0; i < config_.approachSteps; i++)
+    {
+        const Eigen::Vector3f candidate = rotvec * cos(i * step) + side * sin(i * step);
+        const float dotp = candidate.dot(robvec);
+        if (dotp > best)
+        {
+            best = dotp;
+            chosen = candidate;
+        }
+    }
+    rotvec = chosen.normalized();
+
+    out.pose[3] = acos(planevec(0));
+    out.pose[4] = asin(rotvec(1)); //in radians
+    out.pose[5] = atan2(rotvec(0), rotvec(2));
+    return true;
+}
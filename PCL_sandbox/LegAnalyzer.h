@@ -0,0 +1,81 @@
+#ifndef LEG_ANALYZER_H
+#define LEG_ANALYZER_H
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+// Ordered outline of the leg on the table plane, as produced by pcl::ConcaveHull
+typedef pcl::PointCloud<pcl::PointXYZ> Contour;
+
+// End effector pose for one cut and the contour indices it was derived from
+struct CutPose
+{
+    bool valid;
+    float pose[6]; // x, y, z and three angles in radians
+    int tip;       // narrow end of the longest line
+    int base;      // wide end of the longest line
+    int cut1;      // contour points on either side of the cut
+    int cut2;
+    float width;   // distance between cut1 and cut2
+    int fixed1;    // fixed-distance estimate (tipDistance from the tip) before
+    int fixed2;    // it is merged with the thinnest cross line
+};
+
+// Contour -> cut -> pose. Configure once, then call process() for every frame.
+// All working buffers are members so repeated calls do not allocate once they
+// have grown to the contour size.
+class LegAnalyzer
+{
+public:
+    struct Config
+    {
+        Config();
+
+        float tipDistance;  // distance from the tip for the fixed-distance estimate (m)
+        int neighbourGap;   // contour indices closer than this are never "opposite"
+        int tipWindow;      // indices this close to the tip are mirrored, not searched
+        float maxAngleDev;  // accepted deviation (deg) from perpendicular for a cross line
+        int mergeFraction;  // estimates closer than size/mergeFraction are combined
+        int approachSteps;  // rotations tested when picking the approach vector
+    };
+
+    LegAnalyzer();
+    explicit LegAnalyzer(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+
+    // Grow the internal buffers up front for contours of up to max_points points
+    void reserve(size_t max_points);
+
+    CutPose process(const Contour &contour);
+
+    // Cross lines of the last processed contour, for drawing in a viewer
+    size_t crossCount() const { return cross_from_.size(); }
+    int crossFrom(size_t i) const { return cross_from_[i]; }
+    int crossTo(size_t i) const { return cross_to_[i]; }
+    bool crossValid(size_t i) const { return cross_valid_[i] != 0; }
+    int chosenCross() const { return chosen_cross_; }
+
+private:
+    void findLongestLine(const Contour &contour, int &idx1, int &idx2) const;
+    void buildThicknessProfile(const Contour &contour, int idx1);
+    int nearestOpposite(const Contour &contour, int idx, float &dist) const;
+    int findThinnestValid() const;
+    void fixedDistanceCut(const Contour &contour, int start, int end, int &p1, int &p2) const;
+    bool computePose(const Contour &contour, CutPose &out) const;
+    int indexGap(int a, int b, int n) const;
+
+    Config config_;
+    float cos_window_; // |cos| below this counts as perpendicular
+
+    std::vector<int> cross_from_;  // idx3 in the old code
+    std::vector<int> cross_to_;    // idx4 in the old code
+    std::vector<float> width_;     // length of each cross line
+    std::vector<char> cross_valid_;
+    std::vector<int> valid_;       // indices of the valid cross lines
+    int chosen_cross_;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "MinCutStage.h"
+
+#include <math.h>
+#include <limits>
+#include <boost/graph/boykov_kolmogorov_max_flow.hpp>
+#include <pcl/common/io.h>
+#include <pcl/ModelCoefficients.h>
+#include <pcl/sample_consensus/method_types.h>
+#include <pcl/sample_consensus/model_types.h>
+
+MinCutStage::Config::Config() :
+    voxelResolution(0.008f),
+    seedResolution(0.03f),
+    planeDistance(0.01f),
+    sigma(0.25f),
+    radius(0.3f),
+    sourceWeight(0.8f)
+{}
+
+MinCutStage::MinCutStage() :
+    has_centroid_(false),
+    max_flow_(0.0),
+    roi_cloud_(new pcl::PointCloud<pcl::PointXYZ>),
+    source_(0),
+    sink_(0)
+{
+    configure(Config());
+}
+
+MinCutStage::MinCutStage(const Config &config) :
+    has_centroid_(false),
+    max_flow_(0.0),
+    roi_cloud_(new pcl::PointCloud<pcl::PointXYZ>),
+    source_(0),
+    sink_(0)
+{
+    configure(config);
+}
+
+void MinCutStage::configure(const Config &config)
+{
+    config_ = config;
+    plane_seg_.setOptimizeCoefficients(true);
+    plane_seg_.setModelType(pcl::SACMODEL_PLANE);
+    plane_seg_.setMethodType(pcl::SAC_RANSAC);
+    plane_seg_.setDistanceThreshold(config_.planeDistance);
+}
+
+void MinCutStage::setLegCentroid(const Eigen::Vector3f &centroid)
+{
+    centroid_ = centroid;
+    has_centroid_ = true;
+}
+
+bool MinCutStage::compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, const std::vector<int> &roi,
+                          std::vector<int> &foreground)
+{
+    foreground.clear();
+    max_flow_ = 0.0;
+    pcl::copyPointCloud(*cloud, roi, *roi_cloud_);
+    if (roi_cloud_->points.size() < 3 || !fitTable())
+    {
+        return false;
+    }
+
+    pcl::SupervoxelClustering<pcl::PointXYZ> super(config_.voxelResolution, config_.seedResolution);
+    super.setInputCloud(roi_cloud_);
+    clusters_.clear();
+    adjacency_.clear();
+    super.extract(clusters_);
+    super.getSupervoxelAdjacency(adjacency_);
+
+    nodes_.clear();
+    centres_.clear();
+    node_of_label_.clear();
+    for (std::map<uint32_t, pcl::Supervoxel<pcl::PointXYZ>::Ptr>::const_iterator it = clusters_.begin();
+         it != clusters_.end(); ++it)
+    {
+        node_of_label_[it->first] = static_cast<int>(nodes_.size());
+        nodes_.push_back(it->first);
+        centres_.push_back(it->second->centroid_.getVector3fMap());
+    }
+
+    const int seed = findSeed();
+    if (seed < 0)
+    {
+        return false;
+    }
+    buildGraph(seed);
+
+    max_flow_ = boost::boykov_kolmogorov_max_flow(graph_, boost::vertex(source_, graph_), boost::vertex(sink_, graph_));
+
+    // Nodes still reachable from the source after the cut are the leg
+    boost::property_map<Graph, boost::vertex_color_t>::type colour = boost::get(boost::vertex_color, graph_);
+    const boost::default_color_type source_colour = boost::get(colour, boost::vertex(source_, graph_));
+    std::vector<char> leg(nodes_.size(), 0);
+    for (size_t v = 0; v < nodes_.size(); ++v)
+    {
+        leg[v] = boost::get(colour, boost::vertex(v, graph_)) == source_colour;
+    }
+
+    pcl::PointCloud<pcl::PointXYZL>::Ptr labelled = super.getLabeledCloud();
+    Eigen::Vector3f sum = Eigen::Vector3f::Zero();
+    for (size_t i = 0; i < labelled->points.size(); ++i)
+    {
+        std::map<uint32_t, int>::const_iterator node = node_of_label_.find(labelled->points[i].label);
+        if (node != node_of_label_.end() && leg[node->second])
+        {
+            foreground.push_back(roi[i]);
+            sum += roi_cloud_->points[i].getVector3fMap();
+        }
+    }
+    if (foreground.empty())
+    {
+        has_centroid_ = false;
+        return false;
+    }
+
+    // Seed for the next frame
+    setLegCentroid(sum / static_cast<float>(foreground.size()));
+    return true;
+}
+
+bool MinCutStage::fitTable()
+{
+    pcl::ModelCoefficients coefficients;
+    pcl::PointIndices inliers;
+    plane_seg_.setInputCloud(roi_cloud_);
+    plane_seg_.segment(inliers, coefficients);
+    if (inliers.indices.empty())
+    {
+        return false;
+    }
+
+    // Normal pointing towards the camera, so the leg is on the positive side
+    plane_ = Eigen::Vector4f(coefficients.values[0], coefficients.values[1], coefficients.values[2],
+                             coefficients.values[3]);
+    if (plane_[3] < 0.0f)
+    {
+        plane_ = -plane_;
+    }
+    return true;
+}
+
+int MinCutStage::findSeed() const
+{
+    // Supervoxel closest to last frame's leg, or the one highest above the table
+    int seed = -1;
+    float best = -std::numeric_limits<float>::max();
+    for (size_t v = 0; v < centres_.size(); ++v)
+    {
+        const float score = has_centroid_ ? -(centres_[v] - centroid_).squaredNorm()
+                                          : plane_.head<3>().dot(centres_[v]) + plane_[3];
+        if (score > best)
+        {
+            best = score;
+            seed = static_cast<int>(v);
+        }
+    }
+    return seed;
+}
+
+void MinCutStage::buildGraph(int seed)
+{
+    const int n = static_cast<int>(nodes_.size());
+    source_ = n;
+    sink_ = n + 1;
+    graph_.clear();
+    for (int v = 0; v < n + 2; ++v)
+    {
+        boost::add_vertex(graph_);
+    }
+
+    // Horizontal distances are measured in the table plane
+    const Eigen::Vector3f up = plane_.head<3>();
+    const Eigen::Vector3f &seed_centre = centres_[seed];
+    const double infinite = std::numeric_limits<double>::max();
+    for (int v = 0; v < n; ++v)
+    {
+        const float height = up.dot(centres_[v]) + plane_[3];
+        if (v == seed)
+        {
+            addEdge(source_, v, infinite, 0.0);
+        }
+        else if (height < config_.planeDistance)
+        {
+            addEdge(v, sink_, infinite, 0.0);
+        }
+        else
+        {
+            Eigen::Vector3f offset = centres_[v] - seed_centre;
+            offset -= up * up.dot(offset);
+            addEdge(source_, v, config_.sourceWeight, 0.0);
+            addEdge(v, sink_, offset.norm() / config_.radius, 0.0);
+        }
+    }
+
+    const double inv_sqr_sigma = 1.0 / (config_.sigma * config_.sigma);
+    for (std::multimap<uint32_t, uint32_t>::const_iterator it = adjacency_.begin(); it != adjacency_.end(); ++it)
+    {
+        const int a = node_of_label_[it->first];
+        const int b = node_of_label_[it->second];
+        if (a < b)
+        {
+            const double weight = exp(-(centres_[a] - centres_[b]).squaredNorm() * inv_sqr_sigma);
+            addEdge(a, b, weight, weight);
+        }
+    }
+}
+
+void MinCutStage::addEdge(int from, int to, double capacity, double reverse_capacity)
+{
+    // Boykov-Kolmogorov wants every edge paired with its reverse
+    Traits::edge_descriptor forward = boost::add_edge(from, to, graph_).first;
+    Traits::edge_descriptor backward = boost::add_edge(to, from, graph_).first;
+    boost::put(boost::edge_capacity, graph_, forward, capacity);
+    boost::put(boost::edge_capacity, graph_, backward, reverse_capacity);
+    boost::put(boost::edge_reverse, graph_, forward, backward);
+    boost::put(boost::edge_reverse, graph_, backward, forward);
+}
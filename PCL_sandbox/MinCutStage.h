@@ -0,0 +1,94 @@
+#ifndef MIN_CUT_STAGE_H
+#define MIN_CUT_STAGE_H
+
+#include <map>
+#include <vector>
+#include <boost/graph/adjacency_list.hpp>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/segmentation/supervoxel_clustering.h>
+#include <pcl/segmentation/sac_segmentation.h>
+
+// Leg / background min-cut over supervoxels instead of points, so the flow
+// graph has a few hundred nodes rather than one per point. The foreground is
+// seeded from the leg centroid of the previous frame (the supervoxel highest
+// above the table on the first one), the background from every supervoxel
+// on the table plane. Weights follow pcl::MinCutSegmentation: a constant
+// source weight, a sink weight growing with the horizontal distance from the
+// seed, and exp(-(d/sigma)^2) between adjacent supervoxels.
+class MinCutStage
+{
+public:
+    struct Config
+    {
+        Config();
+
+        float voxelResolution; // supervoxel octree leaf size (m)
+        float seedResolution;  // supervoxel seed spacing (m)
+        float planeDistance;   // RANSAC threshold, and table band for the background (m)
+        float sigma;           // smoothness distance (m)
+        float radius;          // horizontal distance (m) at which the sink weight reaches 1
+        float sourceWeight;
+    };
+
+    MinCutStage();
+    explicit MinCutStage(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+
+    // Seed the next frame at this point, e.g. from another detector
+    void setLegCentroid(const Eigen::Vector3f &centroid);
+    // Forget the previous leg, the next frame seeds from the table height
+    void reset() { has_centroid_ = false; }
+
+    // Foreground points of cloud, as indices into cloud. Only the listed
+    // points take part. Returns false if no table plane or leg was found.
+    bool compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, const std::vector<int> &roi,
+                 std::vector<int> &foreground);
+
+    const Eigen::Vector3f &legCentroid() const { return centroid_; }
+    const Eigen::Vector4f &tablePlane() const { return plane_; }
+    double maxFlow() const { return max_flow_; }
+    size_t supervoxelCount() const { return nodes_.size(); }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+    typedef boost::adjacency_list_traits<boost::vecS, boost::vecS, boost::directedS> Traits;
+    typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::directedS,
+        boost::property<boost::vertex_index_t, long,
+        boost::property<boost::vertex_color_t, boost::default_color_type,
+        boost::property<boost::vertex_distance_t, long,
+        boost::property<boost::vertex_predecessor_t, Traits::edge_descriptor> > > >,
+        boost::property<boost::edge_capacity_t, double,
+        boost::property<boost::edge_residual_capacity_t, double,
+        boost::property<boost::edge_reverse_t, Traits::edge_descriptor> > > > Graph;
+
+    bool fitTable();
+    int findSeed() const;
+    void buildGraph(int seed);
+    void addEdge(int from, int to, double capacity, double reverse_capacity);
+
+    Config config_;
+    Eigen::Vector4f plane_;
+    Eigen::Vector3f centroid_;
+    bool has_centroid_;
+    double max_flow_;
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr roi_cloud_;
+    pcl::SACSegmentation<pcl::PointXYZ> plane_seg_;
+
+    // Supervoxels of the last frame: label, centroid and adjacency by node
+    std::map<uint32_t, pcl::Supervoxel<pcl::PointXYZ>::Ptr> clusters_;
+    std::multimap<uint32_t, uint32_t> adjacency_;
+    std::map<uint32_t, int> node_of_label_;
+    std::vector<uint32_t> nodes_;
+    std::vector<Eigen::Vector3f, Eigen::aligned_allocator<Eigen::Vector3f> > centres_;
+
+    Graph graph_;
+    int source_;
+    int sink_;
+};
+
+#endif
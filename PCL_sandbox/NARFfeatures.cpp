@@ -4,205 +4,78 @@
 
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
-#include <pcl/PCLPointCloud2.h>
 #include <pcl_conversions/pcl_conversions.h>
-#include <pcl/ros/conversions.h>
-#include <pcl/conversions.h>
 #include <pcl/point_cloud.h>
-#include <pcl/ModelCoefficients.h>
-#include <pcl/io/pcd_io.h>
 #include <pcl/point_types.h>
-#include <pcl/sample_consensus/method_types.h>
-#include <pcl/sample_consensus/model_types.h>
-#include <pcl/segmentation/sac_segmentation.h>
-#include <pcl/filters/voxel_grid.h>
-#include <pcl/filters/extract_indices.h>
-#include <pcl_ros/transforms.h>
-#include <boost/thread/thread.hpp>
-#include <pcl/range_image/range_image.h>
-#include <pcl/io/pcd_io.h>
-#include <pcl/visualization/range_image_visualizer.h>
-#include <pcl/visualization/pcl_visualizer.h>
 #include <pcl/features/range_image_border_extractor.h>
 #include <pcl/keypoints/narf_keypoint.h>
 #include <pcl/features/narf_descriptor.h>
 #include <pcl/console/parse.h>
+#include "KinectRangeImage.h"
 
-ros::Publish pub;
+ros::Publisher pub;
+
+// --------------------
+// -----Parameters-----
+// --------------------
+float support_size = 0.2f;
+bool rotation_invariant = true;
+
+// Kept between frames, so the range image reuses its buffers
+pcl::PointCloud<pcl::PointXYZ> point_cloud;
+KinectRangeImage range_image;
+pcl::RangeImageBorderExtractor range_image_border_extractor;
+pcl::NarfKeypoint narf_keypoint_detector;
 
 // --------------
 // -----Help-----
 // --------------
 void printUsage (const char* progName)
 {
-  std::cout << "\n\nUsage: "<<progName<<" [options] <scene.pcd>\n\n"
+  std::cout << "\n\nUsage: "<<progName<<" [options]\n\n"
             << "Options:\n"
             << "-------------------------------------------\n"
-            << "-r <float>   angular resolution in degrees (default "<<angular_resolution<<")\n"
-            << "-c <int>     coordinate frame (default "<< (int)coordinate_frame<<")\n"
-            << "-m           Treat all unseen points to max range\n"
             << "-s <float>   support size for the interest points (diameter of the used sphere - "
                                                                   "default "<<support_size<<")\n"
             << "-o <0/1>     switch rotational invariant version of the feature on/off"
             <<               " (default "<< (int)rotation_invariant<<")\n"
+            << "-fx <float>  depth camera focal length in x (default "<<range_image.intrinsics ().fx<<")\n"
+            << "-fy <float>  depth camera focal length in y (default "<<range_image.intrinsics ().fy<<")\n"
+            << "-cx <float>  principal point x (default "<<range_image.intrinsics ().cx<<")\n"
+            << "-cy <float>  principal point y (default "<<range_image.intrinsics ().cy<<")\n"
             << "-h           this help\n"
             << "\n\n";
 }
 
-void callback(const sensor_msgs::PointCloud2ConstPtr& input)
+void callBack(const sensor_msgs::PointCloud2ConstPtr& input)
 {
-    //Catching the stream of data from the topic
-    pcl::PCLPointCloud2::Ptr cloud_blob (new pcl::PCLPointCloud2);
-    pcl_conversions::toPCL(*input, *cloud_blob);
-
-    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud_to_use (new pcl::PointCloud<pcl::PointXYZ>);
-    pcl_conversions::toPCL(*input, *cloud_to_use);
-
-    typedef pcl::PointXYZ PointType;
-
-    // --------------------
-    // -----Parameters-----
-    // --------------------
-    float angular_resolution = 0.5f;
-    float support_size = 0.2f;
-    pcl::RangeImage::CoordinateFrame coordinate_frame = pcl::RangeImage::CAMERA_FRAME;
-    bool setUnseenToMaxRange = false;
-    bool rotation_invariant = true;
-    
-    if (pcl::console::find_argument (argc, argv, "-h") >= 0)
-    {
-        printUsage (argv[0]);
-        return 0;
-    }
-    if (pcl::console::find_argument (argc, argv, "-m") >= 0)
-    {
-        setUnseenToMaxRange = true;
-        cout << "Setting unseen values in range image to maximum range readings.\n";
-    }
-    if (pcl::console::parse (argc, argv, "-o", rotation_invariant) >= 0)
-        cout << "Switching rotation invariant feature version "<< (rotation_invariant ? "on" : "off")<<".\n";
-        int tmp_coordinate_frame;
-    if (pcl::console::parse (argc, argv, "-c", tmp_coordinate_frame) >= 0)
-    {
-        coordinate_frame = pcl::RangeImage::CoordinateFrame (tmp_coordinate_frame);
-        cout << "Using coordinate frame "<< (int)coordinate_frame<<".\n";
-    }
-    if (pcl::console::parse (argc, argv, "-s", support_size) >= 0)
-        cout << "Setting support size to "<<support_size<<".\n";
-    if (pcl::console::parse (argc, argv, "-r", angular_resolution) >= 0)
-        cout << "Setting angular resolution to "<<angular_resolution<<"deg.\n";
-        angular_resolution = pcl::deg2rad (angular_resolution);
-
-    // ------------------------------------------------------------------
-    // -----Read pcd file or create example point cloud if not given-----
-    // ------------------------------------------------------------------
-    pcl::PointCloud<PointType>::Ptr point_cloud_ptr (new pcl::PointCloud<PointType>);
-    pcl::PointCloud<PointType>& point_cloud = *point_cloud_ptr;
-    pcl::PointCloud<pcl::PointWithViewpoint> far_ranges;
-    Eigen::Affine3f scene_sensor_pose (Eigen::Affine3f::Identity ());
-    std::vector<int> pcd_filename_indices = pcl::console::parse_file_extension_argument (argc, argv, "pcd");
-
-    if (!pcd_filename_indices.empty ())
-    {
-        std::string filename = argv[pcd_filename_indices[0]];
-        if (pcl::io::loadPCDFile (filename, point_cloud) == -1)
-    {
-        cerr << "Was not able to open file \""<<filename<<"\".\n";
-        printUsage (argv[0]);
-        return 0;
-    }
+    pcl::fromROSMsg (*input, point_cloud);
 
-    scene_sensor_pose = Eigen::Affine3f (Eigen::Translation3f (point_cloud.sensor_origin_[0],
-                                                               point_cloud.sensor_origin_[1],
-                                                               point_cloud.sensor_origin_[2])) *
-                        Eigen::Affine3f (point_cloud.sensor_orientation_);
-    std::string far_ranges_filename = pcl::getFilenameWithoutExtension (filename)+"_far_ranges.pcd";
-    
-    if (pcl::io::loadPCDFile (far_ranges_filename.c_str (), far_ranges) == -1)
-      std::cout << "Far ranges file \""<<far_ranges_filename<<"\" does not exists.\n";
-    }
-    else
+    // -----------------------------------------------------
+    // -----Take the organized frame as the range image-----
+    // -----------------------------------------------------
+    if (!range_image.setFrame (point_cloud))
     {
-    setUnseenToMaxRange = true;
-    cout << "\nNo *.pcd file given => Generating example point cloud.\n\n";
-    for (float x=-0.5f; x<=0.5f; x+=0.01f)
-    {
-      for (float y=-0.5f; y<=0.5f; y+=0.01f)
-      {
-        PointType point;  point.x = x;  point.y = y;  point.z = 2.0f - y;
-        point_cloud.points.push_back (point);
-      }
-    }
-    
-    point_cloud.width = (int) point_cloud.points.size ();  point_cloud.height = 1;
+        ROS_WARN_ONCE ("NARF needs the organized frame, got %u x %u", point_cloud.width, point_cloud.height);
+        return;
     }
 
-    // -----------------------------------------------
-    // -----Create RangeImage from the PointCloud-----
-    // -----------------------------------------------
-    float noise_level = 0.0;
-    float min_range = 0.0f;
-    int border_size = 1;
-    pcl::RangeImage::Ptr range_image_ptr (new pcl::RangeImage);
-    pcl::RangeImage& range_image = *range_image_ptr;   
-    range_image.createFromPointCloud (point_cloud, angular_resolution, pcl::deg2rad (360.0f), pcl::deg2rad (180.0f),
-                                   scene_sensor_pose, coordinate_frame, noise_level, min_range, border_size);
-    range_image.integrateFarRanges (far_ranges);
-    
-    if (setUnseenToMaxRange)
-    range_image.setUnseenToMaxRange ();
-
-    // --------------------------------------------
-    // -----Open 3D viewer and add point cloud-----
-    // --------------------------------------------
-    pcl::visualization::PCLVisualizer viewer ("3D Viewer");
-    viewer.setBackgroundColor (1, 1, 1);
-    pcl::visualization::PointCloudColorHandlerCustom<pcl::PointWithRange> range_image_color_handler (range_image_ptr, 0, 0, 0);
-    viewer.addPointCloud (range_image_ptr, range_image_color_handler, "range image");
-    viewer.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 1, "range image");
-    //viewer.addCoordinateSystem (1.0f, "global");
-    //PointCloudColorHandlerCustom<PointType> point_cloud_color_handler (point_cloud_ptr, 150, 150, 150);
-    //viewer.addPointCloud (point_cloud_ptr, point_cloud_color_handler, "original point cloud");
-    viewer.initCameraParameters ();
-    setViewerPose (viewer, range_image.getTransformationToWorldSystem ());
-
-    // --------------------------
-    // -----Show range image-----
-    // --------------------------
-    pcl::visualization::RangeImageVisualizer range_image_widget ("Range image");
-    range_image_widget.showRangeImage (range_image);
-
     // --------------------------------
     // -----Extract NARF keypoints-----
     // --------------------------------
-    pcl::RangeImageBorderExtractor range_image_border_extractor;
-    pcl::NarfKeypoint narf_keypoint_detector;
-    narf_keypoint_detector.setRangeImageBorderExtractor (&range_image_border_extractor);
+    range_image_border_extractor.setRangeImage (&range_image);
     narf_keypoint_detector.setRangeImage (&range_image);
-    narf_keypoint_detector.getParameters ().support_size = support_size;
 
     pcl::PointCloud<int> keypoint_indices;
     narf_keypoint_detector.compute (keypoint_indices);
-    std::cout << "Found "<<keypoint_indices.points.size ()<<" key points.\n";
-
-    // ----------------------------------------------
-    // -----Show keypoints in range image widget-----
-    // ----------------------------------------------
-    //for (size_t i=0; i<keypoint_indices.points.size (); ++i)
-    //range_image_widget.markPoint (keypoint_indices.points[i]%range_image.width,
-                                  //keypoint_indices.points[i]/range_image.width);
-
-    // -------------------------------------
-    // -----Show keypoints in 3D viewer-----
-    // -------------------------------------
-    pcl::PointCloud<pcl::PointXYZ>::Ptr keypoints_ptr (new pcl::PointCloud<pcl::PointXYZ>);
-    pcl::PointCloud<pcl::PointXYZ>& keypoints = *keypoints_ptr;
+
+    pcl::PointCloud<pcl::PointXYZ> keypoints;
     keypoints.points.resize (keypoint_indices.points.size ());
     for (size_t i=0; i<keypoint_indices.points.size (); ++i)
         keypoints.points[i].getVector3fMap () = range_image.points[keypoint_indices.points[i]].getVector3fMap ();
-    pcl::visualization::PointCloudColorHandlerCustom<pcl::PointXYZ> keypoints_color_handler (keypoints_ptr, 0, 255, 0);
-    viewer.addPointCloud<pcl::PointXYZ> (keypoints_ptr, keypoints_color_handler, "keypoints");
-    viewer.setPointCloudRenderingProperties (pcl::visualization::PCL_VISUALIZER_POINT_SIZE, 7, "keypoints");
+    keypoints.width = (int) keypoints.points.size ();
+    keypoints.height = 1;
+    keypoints.header = point_cloud.header;
 
     // ------------------------------------------------------
     // -----Extract NARF descriptors for interest points-----
@@ -216,18 +89,12 @@ void callback(const sensor_msgs::PointCloud2ConstPtr& input)
     narf_descriptor.getParameters ().rotation_invariant = rotation_invariant;
     pcl::PointCloud<pcl::Narf36> narf_descriptors;
     narf_descriptor.compute (narf_descriptors);
-    cout << "Extracted "<<narf_descriptors.size ()<<" descriptors for "
-                      <<keypoint_indices.points.size ()<< " keypoints.\n";
+    ROS_DEBUG ("Extracted %lu descriptors for %lu keypoints", (unsigned long) narf_descriptors.size (),
+               (unsigned long) keypoint_indices.points.size ());
 
-    //--------------------
-    // -----Main loop-----
-    //--------------------
-    while (!viewer.wasStopped ())
-    {
-        range_image_widget.spinOnce ();  // process GUI events
-        viewer.spinOnce ();
-        pcl_sleep(0.01);
-    }
+    sensor_msgs::PointCloud2 output;
+    pcl::toROSMsg (keypoints, output);
+    pub.publish (output);
 }
 
 int main(int argc, char** argv)
@@ -236,12 +103,35 @@ int main(int argc, char** argv)
     ros::init (argc, argv, "narf_try");
     ros::NodeHandle nh;
 
+    if (pcl::console::find_argument (argc, argv, "-h") >= 0)
+    {
+        printUsage (argv[0]);
+        return 0;
+    }
+    if (pcl::console::parse (argc, argv, "-o", rotation_invariant) >= 0)
+        std::cout << "Switching rotation invariant feature version "<< (rotation_invariant ? "on" : "off")<<".\n";
+    if (pcl::console::parse (argc, argv, "-s", support_size) >= 0)
+        std::cout << "Setting support size to "<<support_size<<".\n";
+
+    // Kinect2 sd intrinsics unless given
+    KinectRangeImage::Intrinsics intrinsics;
+    pcl::console::parse (argc, argv, "-fx", intrinsics.fx);
+    pcl::console::parse (argc, argv, "-fy", intrinsics.fy);
+    pcl::console::parse (argc, argv, "-cx", intrinsics.cx);
+    pcl::console::parse (argc, argv, "-cy", intrinsics.cy);
+    range_image.setIntrinsics (intrinsics);
+
+    narf_keypoint_detector.setRangeImageBorderExtractor (&range_image_border_extractor);
+    narf_keypoint_detector.getParameters ().support_size = support_size;
+
     // Create a ROS subscriber for the input point cloud
     ros::Subscriber sub = nh.subscribe ("/kinect2/sd/points", 1, callBack);
 
-    // Create a ROS publisher for the output model coefficients
+    // Keypoints of every frame
     pub = nh.advertise<sensor_msgs::PointCloud2> ("output", 1);
 
     // Spin
     ros::spin ();
-}
\ No newline at end of file
+
+    return 0;
+}
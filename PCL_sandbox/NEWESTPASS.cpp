@@ -4,7 +4,6 @@
 #include <pcl/filters/passthrough.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/visualization/cloud_viewer.h>
-#include <pcl/features/moment_of_inertia_estimation.h>
 #include <vector>
 #include <pcl/visualization/cloud_viewer.h>
 #include <boost/thread/thread.hpp>
@@ -23,6 +22,10 @@
 
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/principal_curvatures.h>
+#include <pcl/common/io.h>
+#include <limits>
+#include "NormalStage.h"
+#include "BoxStage.h"
 
 using namespace std;
 
@@ -55,36 +58,18 @@ int
   pcl::io::loadPCDFile <pcl::PointXYZ> ("goodscan.pcd", *cloud);
 
 
-  // Create the filtering object
-  pcl::PassThrough<pcl::PointXYZ> pass;
-  pass.setInputCloud(cloud);
-  pass.setFilterFieldName ("z");
-  pass.setFilterLimits(0.30, 1.03);
+  // Crop to the leg, keeping only the indices so the frame stays organized
+  // for the normal estimation. The box sums are taken in the same pass.
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<int> roi_indices;
+  BoxStage feature_extractor;
+  feature_extractor.crop(*cloud, Eigen::Vector3f(-0.30f, -inf, 0.30f), Eigen::Vector3f(0.20f, inf, 1.03f), roi_indices);
+  feature_extractor.compute(*cloud, roi_indices);
+  pcl::copyPointCloud(*cloud, roi_indices, *final_cloud);
 
-  //pass.setFilterLimitsNegative (true);
-  pass.filter(*cloud_filtered);
-
-//normals
-  
-
-  // pcl::PassThrough<pcl::PointXYZ> pass1;
-  pass.setInputCloud(cloud_filtered);
-  pass.setFilterFieldName ("x");
-  pass.setFilterLimits(-0.30, 0.20);
-
-  pass.filter(*final_cloud);
-
-  pcl::MomentOfInertiaEstimation <pcl::PointXYZ> feature_extractor;
-  feature_extractor.setInputCloud(final_cloud);
-  feature_extractor.compute();
-
-  std::vector <float> moment_of_inertia;
-  std::vector <float> eccentricity;
   float major_value, middle_value, minor_value;
   Eigen::Vector3f major_vector, middle_vector, minor_vector;
   Eigen::Vector3f mass_center;
-  feature_extractor.getMomentOfInertia (moment_of_inertia);
-  feature_extractor.getEccentricity (eccentricity);
   feature_extractor.getEigenValues (major_value, middle_value, minor_value);
   feature_extractor.getEigenVectors (major_vector, middle_vector, minor_vector);
   feature_extractor.getMassCenter (mass_center);
@@ -111,22 +96,12 @@ int
 
 
   
-  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-  ne.setInputCloud(final_cloud);
-
-  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-  ne.setSearchMethod (tree);
-
   // Output datasets
   pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
-  
-
-
-  // Use all neighbors in a sphere of radius 3cm
-  ne.setRadiusSearch (0.03);
 
-  // Compute the features
-  ne.compute(*normals);
+  // Use all neighbors in a sphere of radius 3cm, or the matching pixel window on organized frames
+  NormalStage normal_stage;
+  normal_stage.compute(cloud, roi_indices, *normals);
   cout << "output points.size (): " << normals->points.size() << endl;
 
   
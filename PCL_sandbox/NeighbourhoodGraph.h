@@ -0,0 +1,282 @@
+#ifndef NEIGHBOURHOOD_GRAPH_H
+#define NEIGHBOURHOOD_GRAPH_H
+
+#include <vector>
+#include <limits>
+#include <thread>
+#include <algorithm>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/common/point_tests.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/features/fpfh.h>
+#include <pcl/features/principal_curvatures.h>
+
+// Neighbour lists of every point, searched once and stored back to back
+// (compressed sparse rows). Normal, FPFH and curvature estimation read from
+// the same lists instead of each searching the tree again. A stage with a
+// smaller radius than the graph filters the stored lists by distance.
+// Header only, so the Visual Studio sources can include it directly.
+template <typename PointT>
+class NeighbourhoodGraph
+{
+public:
+    typedef pcl::PointCloud<PointT> Cloud;
+    typedef typename pcl::search::KdTree<PointT>::Ptr TreePtr;
+
+    NeighbourhoodGraph() :
+        radius_(0.0),
+        tree_(new pcl::search::KdTree<PointT>),
+        threads_(1)
+    {}
+
+    // Use an existing tree object instead of the graph's own
+    void setSearchMethod(const TreePtr &tree) { tree_ = tree; }
+
+    // Split the searches over this many threads, 0 for one per core
+    void setNumberOfThreads(unsigned int threads)
+    {
+        threads_ = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Radius neighbours of every point, at most max_nn of them if max_nn > 0
+    void build(const typename Cloud::ConstPtr &cloud, double radius, unsigned int max_nn = 0)
+    {
+        radius_ = radius;
+        buildRows(cloud, radius, 0, max_nn);
+    }
+
+    // The k nearest neighbours of every point
+    void buildK(const typename Cloud::ConstPtr &cloud, int k)
+    {
+        radius_ = std::numeric_limits<double>::max();
+        buildRows(cloud, 0.0, k, 0);
+    }
+
+    typename Cloud::ConstPtr cloud() const { return cloud_; }
+    size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+    double radius() const { return radius_; }
+
+    // Raw row of point i: its neighbours are indices()[begin(i)] .. indices()[end(i) - 1]
+    size_t begin(size_t i) const { return offsets_[i]; }
+    size_t end(size_t i) const { return offsets_[i + 1]; }
+    const std::vector<int> &indices() const { return indices_; }
+    const std::vector<float> &sqrDistances() const { return sqr_dists_; }
+
+    // Neighbours of point i within radius (at most the build radius), in the
+    // vector form the PCL helpers take. Returns the neighbour count.
+    size_t neighbours(size_t i, double radius, std::vector<int> &indices, std::vector<float> &sqr_dists) const
+    {
+        indices.clear();
+        sqr_dists.clear();
+        const float limit = static_cast<float>(radius * radius);
+        for (size_t j = offsets_[i]; j < offsets_[i + 1]; ++j)
+        {
+            if (sqr_dists_[j] <= limit)
+            {
+                indices.push_back(indices_[j]);
+                sqr_dists.push_back(sqr_dists_[j]);
+            }
+        }
+        return indices.size();
+    }
+
+private:
+    // Neighbours of one block of points, kept apart until all blocks are done
+    struct Block
+    {
+        std::vector<size_t> counts;
+        std::vector<int> indices;
+        std::vector<float> sqr_dists;
+    };
+
+    void buildRows(const typename Cloud::ConstPtr &cloud, double radius, int k, unsigned int max_nn)
+    {
+        cloud_ = cloud;
+        tree_->setInputCloud(cloud);
+
+        const size_t n = cloud->points.size();
+        const size_t nr_blocks = std::max<size_t>(1, std::min<size_t>(threads_, n));
+        std::vector<Block> blocks(nr_blocks);
+        std::vector<std::thread> workers;
+        for (size_t b = 1; b < nr_blocks; ++b)
+        {
+            workers.push_back(std::thread(&NeighbourhoodGraph::searchBlock, this, b * n / nr_blocks,
+                                          (b + 1) * n / nr_blocks, radius, k, max_nn, &blocks[b]));
+        }
+        searchBlock(0, n / nr_blocks, radius, k, max_nn, &blocks[0]);
+        for (size_t t = 0; t < workers.size(); ++t)
+        {
+            workers[t].join();
+        }
+
+        // Stitch the blocks into the rows
+        offsets_.clear();
+        offsets_.reserve(n + 1);
+        offsets_.push_back(0);
+        indices_.clear();
+        sqr_dists_.clear();
+        for (size_t b = 0; b < nr_blocks; ++b)
+        {
+            for (size_t i = 0; i < blocks[b].counts.size(); ++i)
+            {
+                offsets_.push_back(offsets_.back() + blocks[b].counts[i]);
+            }
+            indices_.insert(indices_.end(), blocks[b].indices.begin(), blocks[b].indices.end());
+            sqr_dists_.insert(sqr_dists_.end(), blocks[b].sqr_dists.begin(), blocks[b].sqr_dists.end());
+        }
+    }
+
+    void searchBlock(size_t first, size_t last, double radius, int k, unsigned int max_nn, Block *block) const
+    {
+        std::vector<int> nn_indices;
+        std::vector<float> nn_dists;
+        block->counts.reserve(last - first);
+        for (size_t i = first; i < last; ++i)
+        {
+            nn_indices.clear();
+            nn_dists.clear();
+            const PointT &p = cloud_->points[i];
+            if (pcl::isFinite(p))
+            {
+                if (k > 0)
+                {
+                    tree_->nearestKSearch(p, k, nn_indices, nn_dists);
+                }
+                else
+                {
+                    tree_->radiusSearch(p, radius, nn_indices, nn_dists, max_nn);
+                }
+            }
+            block->counts.push_back(nn_indices.size());
+            block->indices.insert(block->indices.end(), nn_indices.begin(), nn_indices.end());
+            block->sqr_dists.insert(block->sqr_dists.end(), nn_dists.begin(), nn_dists.end());
+        }
+    }
+
+    typename Cloud::ConstPtr cloud_;
+    double radius_;
+    TreePtr tree_;
+    unsigned int threads_;
+
+    std::vector<size_t> offsets_; // size() + 1 entries
+    std::vector<int> indices_;
+    std::vector<float> sqr_dists_;
+};
+
+// Output cloud with the same layout as the graph's cloud
+template <typename PointT, typename PointOutT> void
+prepareOutput(const NeighbourhoodGraph<PointT> &graph, pcl::PointCloud<PointOutT> &output)
+{
+    output.points.resize(graph.size());
+    output.header = graph.cloud()->header;
+    output.width = graph.cloud()->width;
+    output.height = graph.cloud()->height;
+    output.is_dense = true;
+}
+
+// Same result as pcl::NormalEstimation with the given radius and viewpoint
+template <typename PointT> void
+computeNormals(const NeighbourhoodGraph<PointT> &graph, double radius, pcl::PointCloud<pcl::Normal> &normals,
+               float vpx = 0.0f, float vpy = 0.0f, float vpz = 0.0f)
+{
+    const pcl::PointCloud<PointT> &cloud = *graph.cloud();
+    prepareOutput(graph, normals);
+
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    for (size_t i = 0; i < graph.size(); ++i)
+    {
+        pcl::Normal &n = normals.points[i];
+        Eigen::Vector4f plane;
+        if (graph.neighbours(i, radius, nn_indices, nn_dists) < 3 ||
+            !pcl::computePointNormal(cloud, nn_indices, plane, n.curvature))
+        {
+            n.normal_x = n.normal_y = n.normal_z = n.curvature = std::numeric_limits<float>::quiet_NaN();
+            normals.is_dense = false;
+            continue;
+        }
+        pcl::flipNormalTowardsViewpoint(cloud.points[i], vpx, vpy, vpz, plane);
+        n.normal_x = plane[0];
+        n.normal_y = plane[1];
+        n.normal_z = plane[2];
+    }
+}
+
+// Same result as pcl::FPFHEstimation with the given radius
+template <typename PointT> void
+computeFPFH(const NeighbourhoodGraph<PointT> &graph, double radius, const pcl::PointCloud<pcl::Normal> &normals,
+            pcl::PointCloud<pcl::FPFHSignature33> &features)
+{
+    const pcl::PointCloud<PointT> &cloud = *graph.cloud();
+    prepareOutput(graph, features);
+
+    // The per-point SPFH and the weighting step are public helpers of the PCL estimator
+    pcl::FPFHEstimation<PointT, pcl::Normal, pcl::FPFHSignature33> fpfh;
+    Eigen::MatrixXf hist_f1 = Eigen::MatrixXf::Zero(graph.size(), 11);
+    Eigen::MatrixXf hist_f2 = Eigen::MatrixXf::Zero(graph.size(), 11);
+    Eigen::MatrixXf hist_f3 = Eigen::MatrixXf::Zero(graph.size(), 11);
+    Eigen::VectorXf fpfh_histogram = Eigen::VectorXf::Zero(33);
+
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    for (size_t i = 0; i < graph.size(); ++i)
+    {
+        if (graph.neighbours(i, radius, nn_indices, nn_dists) > 0)
+        {
+            fpfh.computePointSPFHSignature(cloud, normals, static_cast<int>(i), static_cast<int>(i),
+                                           nn_indices, hist_f1, hist_f2, hist_f3);
+        }
+    }
+
+    for (size_t i = 0; i < graph.size(); ++i)
+    {
+        pcl::FPFHSignature33 &f = features.points[i];
+        // Like PCL, only an empty search gives NaN: a point alone in its
+        // radius gets an all-zero histogram
+        if (graph.neighbours(i, radius, nn_indices, nn_dists) == 0)
+        {
+            for (int d = 0; d < 33; ++d)
+            {
+                f.histogram[d] = std::numeric_limits<float>::quiet_NaN();
+            }
+            features.is_dense = false;
+            continue;
+        }
+        fpfh.weightPointSPFHSignature(hist_f1, hist_f2, hist_f3, nn_indices, nn_dists, fpfh_histogram);
+        for (int d = 0; d < 33; ++d)
+        {
+            f.histogram[d] = fpfh_histogram[d];
+        }
+    }
+}
+
+// Same result as pcl::PrincipalCurvaturesEstimation with the given radius
+template <typename PointT> void
+computePrincipalCurvatures(const NeighbourhoodGraph<PointT> &graph, double radius,
+                           const pcl::PointCloud<pcl::Normal> &normals,
+                           pcl::PointCloud<pcl::PrincipalCurvatures> &curvatures)
+{
+    prepareOutput(graph, curvatures);
+
+    pcl::PrincipalCurvaturesEstimation<PointT, pcl::Normal, pcl::PrincipalCurvatures> pce;
+    std::vector<int> nn_indices;
+    std::vector<float> nn_dists;
+    for (size_t i = 0; i < graph.size(); ++i)
+    {
+        pcl::PrincipalCurvatures &c = curvatures.points[i];
+        if (graph.neighbours(i, radius, nn_indices, nn_dists) == 0)
+        {
+            c.principal_curvature[0] = c.principal_curvature[1] = c.principal_curvature[2] =
+                c.pc1 = c.pc2 = std::numeric_limits<float>::quiet_NaN();
+            curvatures.is_dense = false;
+            continue;
+        }
+        pce.computePointPrincipalCurvatures(normals, static_cast<int>(i), nn_indices,
+                                            c.principal_curvature[0], c.principal_curvature[1],
+                                            c.principal_curvature[2], c.pc1, c.pc2);
+    }
+}
+
+#endif
@@ -3,7 +3,7 @@
 #include <pcl/filters/passthrough.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/visualization/cloud_viewer.h>
-#include <pcl/features/moment_of_inertia_estimation.h>
+#include "BoxStage.h"
 #include <vector>
 #include <pcl/visualization/cloud_viewer.h>
 #include <boost/thread/thread.hpp>
@@ -210,12 +210,10 @@ while (!viewer->wasStopped ())
   else
     viewer.addPointCloud<pcl::PointXYZ> (cloud, "name");*/
 /*
-  pcl::MomentOfInertiaEstimation <pcl::PointXYZ> feature_extractor;
-  feature_extractor.setInputCloud (cloud_filtered);
-  feature_extractor.compute ();
+  BoxStage feature_extractor;
+  feature_extractor.accumulate (*cloud_filtered);
+  feature_extractor.compute (*cloud_filtered);
 
-  std::vector <float> moment_of_inertia;
-  std::vector <float> eccentricity;
   pcl::PointXYZ min_point_AABB;
   pcl::PointXYZ max_point_AABB;
   pcl::PointXYZ min_point_OBB;
@@ -226,8 +224,6 @@ while (!viewer->wasStopped ())
   Eigen::Vector3f major_vector, middle_vector, minor_vector;
   Eigen::Vector3f mass_center;
 
-  feature_extractor.getMomentOfInertia (moment_of_inertia);
-  feature_extractor.getEccentricity (eccentricity);
   feature_extractor.getAABB (min_point_AABB, max_point_AABB);
   feature_extractor.getOBB (min_point_OBB, max_point_OBB, position_OBB, rotational_matrix_OBB);
   feature_extractor.getEigenValues (major_value, middle_value, minor_value);
@@ -0,0 +1,96 @@
+#include "NormalStage.h"
+
+#include <pcl/common/io.h>
+
+NormalStage::Config::Config() :
+    radius(0.03f),
+    kSearch(0),
+    focalLength(365.5f),
+    workingDepth(0.8f),
+    maxDepthChange(0.02f)
+{}
+
+NormalStage::NormalStage() :
+    tree_(new pcl::search::KdTree<pcl::PointXYZ>),
+    indices_(new std::vector<int>),
+    used_integral_(false)
+{
+    configure(Config());
+}
+
+NormalStage::NormalStage(const Config &config) :
+    tree_(new pcl::search::KdTree<pcl::PointXYZ>),
+    indices_(new std::vector<int>),
+    used_integral_(false)
+{
+    configure(config);
+}
+
+void NormalStage::configure(const Config &config)
+{
+    config_ = config;
+
+    // The smoothing size is the full window width, so it has to span the sphere's
+    // diameter: about 27 px for 3 cm at the table
+    const float smoothing = 2.0f * config_.radius * config_.focalLength / config_.workingDepth;
+    integral_.setNormalEstimationMethod(integral_.AVERAGE_3D_GRADIENT);
+    integral_.setMaxDepthChangeFactor(config_.maxDepthChange);
+    integral_.setNormalSmoothingSize(smoothing);
+
+    tree_estimation_.setSearchMethod(tree_);
+    if (config_.kSearch > 0)
+    {
+        tree_estimation_.setKSearch(config_.kSearch);
+        tree_estimation_.setRadiusSearch(0.0);
+    }
+    else
+    {
+        tree_estimation_.setKSearch(0);
+        tree_estimation_.setRadiusSearch(config_.radius);
+    }
+}
+
+void NormalStage::setViewPoint(float vpx, float vpy, float vpz)
+{
+    integral_.setViewPoint(vpx, vpy, vpz);
+    tree_estimation_.setViewPoint(vpx, vpy, vpz);
+}
+
+void NormalStage::compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals)
+{
+    used_integral_ = cloud->isOrganized();
+    if (used_integral_)
+    {
+        integral_.setInputCloud(cloud);
+        integral_.compute(normals);
+    }
+    else
+    {
+        tree_estimation_.setInputCloud(cloud);
+        tree_estimation_.setSearchSurface(cloud);
+        tree_estimation_.setIndices(pcl::IndicesPtr());
+        tree_estimation_.compute(normals);
+    }
+}
+
+void NormalStage::compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, const std::vector<int> &indices,
+                          pcl::PointCloud<pcl::Normal> &normals)
+{
+    used_integral_ = cloud->isOrganized();
+    if (used_integral_)
+    {
+        integral_.setInputCloud(cloud);
+        integral_.compute(frame_normals_);
+        pcl::copyPointCloud(frame_normals_, indices, normals);
+    }
+    else
+    {
+        // Neighbours come from the whole cloud, so the normals at the crop
+        // boundary are the same as without cropping
+        *indices_ = indices;
+        tree_estimation_.setInputCloud(cloud);
+        tree_estimation_.setSearchSurface(cloud);
+        tree_estimation_.setIndices(indices_);
+        tree_estimation_.compute(normals);
+    }
+}
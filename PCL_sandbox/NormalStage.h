@@ -0,0 +1,58 @@
+#ifndef NORMAL_STAGE_H
+#define NORMAL_STAGE_H
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/features/integral_image_normal.h>
+
+// Surface normals for one frame. Organized clouds (the 512x424 Kinect2 frames)
+// are handled on the pixel grid with integral images, so the cost does not
+// depend on the radius; anything else falls back to a kd-tree search.
+class NormalStage
+{
+public:
+    struct Config
+    {
+        Config();
+
+        float radius;         // neighbourhood radius (m) for the tree search
+        int kSearch;          // if > 0, use k nearest neighbours instead of the radius
+        float focalLength;    // depth camera focal length (px), to turn radius into pixels
+        float workingDepth;   // typical distance to the table (m)
+        float maxDepthChange; // depth jump (m) that ends a smoothing window
+    };
+
+    NormalStage();
+    explicit NormalStage(const Config &config);
+
+    void configure(const Config &config);
+    void setViewPoint(float vpx, float vpy, float vpz);
+
+    void compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, pcl::PointCloud<pcl::Normal> &normals);
+
+    // Normals for the listed points only, in that order. An organized frame is
+    // still processed on the full grid and the listed normals picked out, so
+    // crop with indices rather than by copying points out of the frame.
+    void compute(const pcl::PointCloud<pcl::PointXYZ>::ConstPtr &cloud, const std::vector<int> &indices,
+                 pcl::PointCloud<pcl::Normal> &normals);
+
+    // Tree used by the fallback path, so later stages can search the same cloud
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr searchTree() const { return tree_; }
+    bool usedIntegralImage() const { return used_integral_; }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+    Config config_;
+    pcl::IntegralImageNormalEstimation<pcl::PointXYZ, pcl::Normal> integral_;
+    pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> tree_estimation_;
+    pcl::search::KdTree<pcl::PointXYZ>::Ptr tree_;
+    pcl::PointCloud<pcl::Normal> frame_normals_;           // full grid, reused between frames
+    pcl::IndicesPtr indices_;                              // listed points of unorganized input
+    bool used_integral_;
+};
+
+#endif
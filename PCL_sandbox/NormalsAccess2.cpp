@@ -16,12 +16,15 @@
 #include <pcl/sample_consensus/sac_model_cylinder.h>
 #include <pcl/filters/normal_refinement.h>
 #include <pcl/common/centroid.h>
-#include <pcl/filters/voxel_grid.h>
 #include <pcl/conversions.h>
 #include <pcl/PCLPointCloud2.h>
 
 #include <pcl/features/normal_3d.h>
 #include <pcl/features/principal_curvatures.h>
+#include <pcl/common/io.h>
+#include "NormalStage.h"
+#include "CurvatureStage.h"
+#include "HashedVoxelGrid.h"
 
 using namespace std;
 
@@ -53,74 +56,54 @@ int
   pcl::io::loadPCDFile <pcl::PointXYZ> ("goodscan.pcd", *cloud);
 
 
-  // Create the filtering object
+  // Create the filtering object. Only the indices are kept, so the frame stays
+  // organized for the normal estimation
+  pcl::IndicesPtr z_indices (new std::vector<int>);
+  std::vector<int> roi_indices;
   pcl::PassThrough<pcl::PointXYZ> pass;
   pass.setInputCloud(cloud);
   pass.setFilterFieldName ("z");
   pass.setFilterLimits(0.30, 1.03);
 
   //pass.setFilterLimitsNegative (true);
-  pass.filter(*cloud_filtered);
-
-//normals
-  
+  pass.filter(*z_indices);
 
   // pcl::PassThrough<pcl::PointXYZ> pass1;
-  pass.setInputCloud(cloud_filtered);
+  pass.setIndices(z_indices);
   pass.setFilterFieldName ("x");
   pass.setFilterLimits(-0.30, 0.20);
 
-  pass.filter(*final_cloud);
+  pass.filter(roi_indices);
+  pcl::copyPointCloud(*cloud, roi_indices, *final_cloud);
 
   //Voxel grid filter//
-  //pcl::toPCLPointCloud2(*final, *cloud_blob);
+  // Hashed, so a 1mm leaf does not overflow the index like pcl::VoxelGrid.
+  // The normals below are per ROI index, so they would have to be computed
+  // on the downsampled cloud if this is switched on.
   /*
-  pcl::VoxelGrid<pcl::PCLPointCloud2> sor;
-  sor.setInputCloud(cloud_blob);
-  sor.setLeafSize (0.001, 0.001, 0.001);
-  sor.filter(*cloud_after);
+  HashedVoxelGrid<pcl::PointXYZ> sor;
+  sor.setLeafSize (0.001f);
+  sor.setNumberOfThreads (0);
+  sor.filter(*cloud, roi_indices, *final_cloud);
 */
-  //pcl::fromPCLPointCloud2(*cloud_after, *final_cloud);
-
-  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-  ne.setInputCloud(final_cloud);
-
-  pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-  ne.setSearchMethod (tree);
 
   // Output datasets
   pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
-  
 
+  // Use all neighbors in a sphere of radius 3cm, or the matching pixel window on organized frames
+  NormalStage normal_stage;
+  normal_stage.compute(cloud, roi_indices, *normals);
 
-  // Use all neighbors in a sphere of radius 3cm
-  ne.setRadiusSearch (0.03);
+  // Principal curvatures at a few bounded radii instead of one 1m sphere,
+  // which touched nearly the whole leg from every point. The larger scales
+  // are what make the joint stand out.
+  CurvatureStage curvature_stage;
+  Eigen::MatrixXf curvature_signature;
+  curvature_stage.compute(final_cloud, *normals, curvature_signature);
+  cout << "output points.size (): " << curvature_signature.rows() << endl;
 
-  // Compute the features
-  ne.compute(*normals);
-  cout << "h" << endl;
-  // Setup the principal curvatures computation
-  pcl::PrincipalCurvaturesEstimation<pcl::PointXYZ, pcl::Normal, pcl::PrincipalCurvatures> principalCurvaturesEstimation;
-  cout << "e" << endl;
-  // Provide the original point cloud (without normals)
-  principalCurvaturesEstimation.setInputCloud(final_cloud);
-  cout << "r" << endl;
-  // Provide the point cloud with normals
-  principalCurvaturesEstimation.setInputNormals(normals);
-  cout << "e" << endl;
-  // Use the same KdTree from the normal estimation
-  principalCurvaturesEstimation.setSearchMethod (tree);
-  principalCurvaturesEstimation.setRadiusSearch(1.0);
-  cout << "?" << endl;
-  // Actually compute the principal curvatures
-  pcl::PointCloud<pcl::PrincipalCurvatures>::Ptr principalCurvatures (new pcl::PointCloud<pcl::PrincipalCurvatures> ());
-  principalCurvaturesEstimation.compute(*principalCurvatures);
-  cout << "!" << endl;
-  cout << "output points.size (): " << principalCurvatures->points.size () << endl;
-
-  // Display and retrieve the shape context descriptor vector for the 0th point.
-  pcl::PrincipalCurvatures descriptor = principalCurvatures->points[0];
-  cout << descriptor << endl;
+  // Display the signature of the 0th point: pc1 and pc2 per scale
+  cout << curvature_signature.row(0) << endl;
  // cout <<  << endl;
 /*
   pcl::CentroidPoint<pcl::PointXYZ> cen;
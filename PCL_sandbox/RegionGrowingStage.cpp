@@ -0,0 +1,235 @@
+#include "RegionGrowingStage.h"
+
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <thread>
+#include <pcl/common/point_tests.h>
+
+RegionGrowingStage::Config::Config() :
+    smoothnessThreshold(3.0f),
+    curvatureThreshold(1.0f),
+    maxStep(0.01f),
+    eightConnected(true),
+    minClusterSize(50),
+    maxClusterSize(1000000),
+    threads(0)
+{}
+
+RegionGrowingStage::RegionGrowingStage()
+{
+    configure(Config());
+}
+
+RegionGrowingStage::RegionGrowingStage(const Config &config)
+{
+    configure(config);
+}
+
+void RegionGrowingStage::configure(const Config &config)
+{
+    config_ = config;
+    if (config_.threads == 0)
+    {
+        config_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    cos_smoothness_ = cos(config_.smoothnessThreshold * M_PI / 180.0);
+    sqr_step_ = config_.maxStep * config_.maxStep;
+    queues_.resize(config_.threads);
+}
+
+bool RegionGrowingStage::compute(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                                 const pcl::PointCloud<pcl::Normal> &normals, const std::vector<int> &roi)
+{
+    const int n = static_cast<int>(cloud.points.size());
+    labels_.assign(n, -1);
+    sizes_.clear();
+    if (!cloud.isOrganized())
+    {
+        return false;
+    }
+
+    usable_.assign(n, 0);
+    for (size_t k = 0; k < roi.size(); ++k)
+    {
+        const int i = roi[k];
+        usable_[i] = pcl::isFinite(cloud.points[i]) && pcl_isfinite(normals.points[i].normal_x);
+    }
+
+    // Every band labels its regions with the index of their first pixel, so
+    // the labels are unique without any coordination between the bands
+    const int height = static_cast<int>(cloud.height);
+    const int nr_bands = std::max(1, std::min(static_cast<int>(config_.threads), height));
+    std::vector<std::thread> workers;
+    for (int b = 1; b < nr_bands; ++b)
+    {
+        workers.push_back(std::thread(&RegionGrowingStage::growBand, this, std::cref(cloud), std::cref(normals),
+                                      b * height / nr_bands, (b + 1) * height / nr_bands, &queues_[b]));
+    }
+    growBand(cloud, normals, 0, height / nr_bands, &queues_[0]);
+    for (size_t t = 0; t < workers.size(); ++t)
+    {
+        workers[t].join();
+    }
+
+    parent_.resize(n);
+    for (int i = 0; i < n; ++i)
+    {
+        parent_[i] = i;
+    }
+    for (int b = 1; b < nr_bands; ++b)
+    {
+        mergeBorder(cloud, normals, b * height / nr_bands);
+    }
+    finish();
+    return true;
+}
+
+void RegionGrowingStage::growBand(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                                  const pcl::PointCloud<pcl::Normal> &normals, int first_row, int last_row,
+                                  std::vector<int> *queue)
+{
+    const int width = static_cast<int>(cloud.width);
+    const int reach = config_.eightConnected ? 1 : 0;
+    for (int seed = first_row * width; seed < last_row * width; ++seed)
+    {
+        if (!usable_[seed] || labels_[seed] >= 0)
+        {
+            continue;
+        }
+        labels_[seed] = seed;
+        queue->clear();
+        queue->push_back(seed);
+        for (size_t head = 0; head < queue->size(); ++head)
+        {
+            const int p = (*queue)[head];
+            const int px = p % width;
+            const int py = p / width;
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                const int y = py + dy;
+                if (y < first_row || y >= last_row)
+                {
+                    continue;
+                }
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    const int x = px + dx;
+                    if ((dx == 0 && dy == 0) || x < 0 || x >= width || (dx != 0 && dy != 0 && !reach))
+                    {
+                        continue;
+                    }
+                    const int q = y * width + x;
+                    if (usable_[q] && labels_[q] < 0 && joins(cloud, normals, p, q))
+                    {
+                        // Curved points end the region where they are
+                        labels_[q] = seed;
+                        if (expands(normals, q))
+                        {
+                            queue->push_back(q);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void RegionGrowingStage::mergeBorder(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                                     const pcl::PointCloud<pcl::Normal> &normals, int row)
+{
+    // Join the regions on either side of the border between row - 1 and row.
+    // Whichever side would have grown across, the point doing the expanding
+    // must be flat, and so must the point it reaches for it to carry on into
+    // the other band's region; a curved point is only a leaf of both.
+    const int width = static_cast<int>(cloud.width);
+    const int reach = config_.eightConnected ? 1 : 0;
+    for (int x = 0; x < width; ++x)
+    {
+        const int p = (row - 1) * width + x;
+        if (labels_[p] < 0 || !expands(normals, p))
+        {
+            continue;
+        }
+        for (int dx = -reach; dx <= reach; ++dx)
+        {
+            if (x + dx < 0 || x + dx >= width)
+            {
+                continue;
+            }
+            const int q = row * width + x + dx;
+            if (labels_[q] >= 0 && expands(normals, q) && joins(cloud, normals, p, q))
+            {
+                const int a = findRoot(labels_[p]);
+                const int b = findRoot(labels_[q]);
+                if (a != b)
+                {
+                    parent_[std::max(a, b)] = std::min(a, b);
+                }
+            }
+        }
+    }
+}
+
+bool RegionGrowingStage::joins(const pcl::PointCloud<pcl::PointXYZ> &cloud,
+                               const pcl::PointCloud<pcl::Normal> &normals, int a, int b) const
+{
+    const pcl::Normal &na = normals.points[a];
+    const pcl::Normal &nb = normals.points[b];
+    if (fabs(na.getNormalVector3fMap().dot(nb.getNormalVector3fMap())) < cos_smoothness_)
+    {
+        return false;
+    }
+    return (cloud.points[a].getVector3fMap() - cloud.points[b].getVector3fMap()).squaredNorm() <= sqr_step_;
+}
+
+int RegionGrowingStage::findRoot(int label)
+{
+    while (parent_[label] != label)
+    {
+        parent_[label] = parent_[parent_[label]];
+        label = parent_[label];
+    }
+    return label;
+}
+
+void RegionGrowingStage::finish()
+{
+    const int n = static_cast<int>(labels_.size());
+    count_.assign(n, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        if (labels_[i] >= 0)
+        {
+            labels_[i] = findRoot(labels_[i]);
+            count_[labels_[i]]++;
+        }
+    }
+
+    // Keep the regions within the size limits, largest first
+    std::vector<std::pair<int, int> > kept;
+    for (int r = 0; r < n; ++r)
+    {
+        if (count_[r] >= config_.minClusterSize && count_[r] <= config_.maxClusterSize)
+        {
+            kept.push_back(std::make_pair(-count_[r], r));
+        }
+    }
+    std::sort(kept.begin(), kept.end());
+
+    remap_.assign(n, -1);
+    sizes_.resize(kept.size());
+    for (size_t l = 0; l < kept.size(); ++l)
+    {
+        remap_[kept[l].second] = static_cast<int>(l);
+        sizes_[l] = -kept[l].first;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        if (labels_[i] >= 0)
+        {
+            labels_[i] = remap_[labels_[i]];
+        }
+    }
+}
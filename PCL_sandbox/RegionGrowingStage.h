@@ -0,0 +1,76 @@
+#ifndef REGION_GROWING_STAGE_H
+#define REGION_GROWING_STAGE_H
+
+#include <vector>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+// Region growing on the pixel grid of an organized frame. Seeds are taken
+// from the ROI only and regions grow to the 4 or 8 grid neighbours, never
+// outside the ROI. A neighbour joins when the normals are within the
+// smoothness angle and the distance is below maxStep. As in pcl::RegionGrowing
+// a point above the curvature threshold is added to the region but does not
+// expand it further (only a seed always expands). The grid is cut into row
+// bands that grow in parallel; regions are merged across a band border where
+// two flat points meet, since a curved point on either side would not have
+// carried the region over.
+class RegionGrowingStage
+{
+public:
+    struct Config
+    {
+        Config();
+
+        float smoothnessThreshold; // largest angle (deg) between neighbouring normals
+        float curvatureThreshold;  // points above this do not expand a region
+        float maxStep;             // largest distance (m) between grid neighbours
+        bool eightConnected;       // 8-connectivity instead of 4
+        int minClusterSize;
+        int maxClusterSize;
+        unsigned int threads;      // row bands grown in parallel, 0 for one per core
+    };
+
+    RegionGrowingStage();
+    explicit RegionGrowingStage(const Config &config);
+
+    void configure(const Config &config);
+    const Config &config() const { return config_; }
+
+    // normals must cover the full grid. Returns false if the cloud is not
+    // organized. Regions are labelled by size, largest first.
+    bool compute(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+                 const std::vector<int> &roi);
+
+    // One label per pixel of the last frame, -1 outside every kept region
+    const std::vector<int> &labels() const { return labels_; }
+    int regionCount() const { return static_cast<int>(sizes_.size()); }
+    int regionSize(int label) const { return sizes_[label]; }
+
+private:
+    void growBand(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+                  int first_row, int last_row, std::vector<int> *queue);
+    void mergeBorder(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+                     int row);
+    bool joins(const pcl::PointCloud<pcl::PointXYZ> &cloud, const pcl::PointCloud<pcl::Normal> &normals,
+               int a, int b) const;
+    bool expands(const pcl::PointCloud<pcl::Normal> &normals, int i) const
+    {
+        return normals.points[i].curvature < config_.curvatureThreshold;
+    }
+    int findRoot(int label);
+    void finish();
+
+    Config config_;
+    float cos_smoothness_;
+    float sqr_step_;
+
+    std::vector<char> usable_; // in the ROI with a finite point and normal
+    std::vector<int> labels_;  // band labels while growing, final labels after
+    std::vector<int> parent_;  // union-find over the band labels
+    std::vector<int> count_;   // pixels per root
+    std::vector<int> remap_;   // root -> final label
+    std::vector<int> sizes_;   // pixels per final label
+    std::vector<std::vector<int> > queues_;
+};
+
+#endif
@@ -9,7 +9,7 @@ and then run the executable  */
 #include <pcl/io/ply_io.h>
 #include <pcl/visualization/cloud_viewer.h>
 #include <pcl/filters/voxel_grid.h>
-#include <pcl/features/moment_of_inertia_estimation.h>
+#include "BoxStage.h"
 
 
 int
@@ -44,9 +44,10 @@ main (int argc, char** argv)
        << " data points (" << pcl::getFieldsList (*cloud_filtered) << ").";
   pcl::fromPCLPointCloud2(*cloud_filtered, *cloud_final);*/
 //Test stuff
-   pcl::MomentOfInertiaEstimation <pcl::PointXYZ> feature_extractor;
-  feature_extractor.setInputCloud (cloud);
-  feature_extractor.compute ();
+   // Mean and covariance in one pass, then the box from the principal axes
+   BoxStage feature_extractor;
+  feature_extractor.accumulate (*cloud);
+  feature_extractor.compute (*cloud);
   pcl::PointXYZ min_point_AABB;
   pcl::PointXYZ max_point_AABB;
   pcl::PointXYZ min_point_OBB;
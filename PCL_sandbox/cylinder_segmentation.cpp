@@ -7,6 +7,9 @@
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/sample_consensus/model_types.h>
 #include <pcl/segmentation/sac_segmentation.h>
+#include <pcl/common/io.h>
+#include "NormalStage.h"
+#include "CylinderFitter.h"
 
 
 typedef pcl::PointXYZ PointT;
@@ -17,12 +20,10 @@ main (int argc, char** argv)
   // All the objects needed
   pcl::PCDReader reader;
   pcl::PassThrough<PointT> pass;
-  pcl::NormalEstimation<PointT, pcl::Normal> ne;
   pcl::SACSegmentationFromNormals<PointT, pcl::Normal> seg; 
   pcl::PCDWriter writer;
   pcl::ExtractIndices<PointT> extract;
   pcl::ExtractIndices<pcl::Normal> extract_normals;
-  pcl::search::KdTree<PointT>::Ptr tree (new pcl::search::KdTree<PointT> ());
 
   // Datasets
   pcl::PointCloud<PointT>::Ptr cloud (new pcl::PointCloud<PointT>);
@@ -37,18 +38,21 @@ main (int argc, char** argv)
   reader.read ("leg1.pcd", *cloud);
   std::cerr << "PointCloud has: " << cloud->points.size () << " data points." << std::endl;
 
-  // Build a passthrough filter to remove spurious NaNs
+  // Build a passthrough filter to remove spurious NaNs. Keep the indices so the
+  // normals can still be estimated on the organized frame.
+  std::vector<int> kept;
   pass.setInputCloud (cloud);
   pass.setFilterFieldName ("z");
   pass.setFilterLimits (0, 1.5);
-  pass.filter (*cloud_filtered);
+  pass.filter (kept);
+  pcl::copyPointCloud (*cloud, kept, *cloud_filtered);
   std::cerr << "PointCloud after filtering has: " << cloud_filtered->points.size () << " data points." << std::endl;
 
-  // Estimate point normals
-  ne.setSearchMethod (tree);
-  ne.setInputCloud (cloud_filtered);
-  ne.setKSearch (50);
-  ne.compute (*cloud_normals);
+  // Estimate point normals, from 50 neighbours if the frame is not organized
+  NormalStage::Config normal_config;
+  normal_config.kSearch = 50;
+  NormalStage normal_stage (normal_config);
+  normal_stage.compute (cloud, kept, *cloud_normals);
 
   // Create the segmentation object for the planar model and set all the parameters
   seg.setOptimizeCoefficients (true);
@@ -82,20 +86,14 @@ main (int argc, char** argv)
   extract_normals.setIndices (inliers_plane);
   extract_normals.filter (*cloud_normals2);
 
-  // Create the segmentation object for cylinder segmentation and set all the parameters
-  seg.setOptimizeCoefficients (true);
-  seg.setModelType (pcl::SACMODEL_CYLINDER);
-  seg.setMethodType (pcl::SAC_RANSAC);
-  seg.setNormalDistanceWeight (0.1);
-  seg.setMaxIterations (10000);
-  seg.setDistanceThreshold (0.05);
-  seg.setRadiusLimits (0, 0.1);
-  seg.setInputCloud (cloud_filtered2);
-  seg.setInputNormals (cloud_normals2);
-
-  // Obtain the cylinder inliers and coefficients
-  seg.segment (*inliers_cylinder, *coefficients_cylinder);
+  // Fit the leg axis: PCA start, then a fixed number of Gauss-Newton steps
+  CylinderFitter fitter;
+  CylinderAxis axis = fitter.fit (*cloud_filtered2, *cloud_normals2);
+  axis.toCoefficients (*coefficients_cylinder);
+  fitter.inliers (*cloud_filtered2, axis, 0.05, inliers_cylinder->indices);
   std::cerr << "Cylinder coefficients: " << *coefficients_cylinder << std::endl;
+  std::cerr << "Axis from " << axis.start.transpose () << " to " << axis.end.transpose ()
+            << ", rms " << axis.rms << (axis.valid ? "" : " (rejected)") << std::endl;
 
   // Write the cylinder inliers to disk
   extract.setInputCloud (cloud_filtered2);
@@ -103,7 +101,7 @@ main (int argc, char** argv)
   extract.setNegative (false);
   pcl::PointCloud<PointT>::Ptr cloud_cylinder (new pcl::PointCloud<PointT> ());
   extract.filter (*cloud_cylinder);
-  if (cloud_cylinder->points.empty ()) 
+  if (!axis.valid || cloud_cylinder->points.empty ()) 
     std::cerr << "Can't find the cylindrical component." << std::endl;
   else
   {
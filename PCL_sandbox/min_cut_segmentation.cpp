@@ -4,7 +4,8 @@
 #include <pcl/point_types.h>
 #include <pcl/visualization/cloud_viewer.h>
 #include <pcl/filters/passthrough.h>
-#include <pcl/segmentation/min_cut_segmentation.h>
+#include <pcl/common/io.h>
+#include "MinCutStage.h"
 
 int main (int argc, char** argv)
 {
@@ -15,39 +16,39 @@ int main (int argc, char** argv)
     return (-1);
   }
 
-  pcl::IndicesPtr indices (new std::vector <int>);
+  std::vector <int> indices;
   pcl::PassThrough<pcl::PointXYZ> pass;
   pass.setInputCloud (cloud);
   pass.setFilterFieldName ("z");
   pass.setFilterLimits (0.0, 1.0);
-  pass.filter (*indices);
+  pass.filter (indices);
 
-  pcl::MinCutSegmentation<pcl::PointXYZ> seg;
-  seg.setInputCloud (cloud);
-  seg.setIndices (indices);
-
-  pcl::PointCloud<pcl::PointXYZ>::Ptr foreground_points(new pcl::PointCloud<pcl::PointXYZ> ());
-  pcl::PointXYZ point;
-  point.x = 68.97;
-  point.y = -18.55;
-  point.z = 0.57;
-  foreground_points->points.push_back(point);
-  seg.setForegroundPoints (foreground_points);
-
-  seg.setSigma (0.25);
-  seg.setRadius (3.0433856);
-  seg.setNumberOfNeighbours (14);
-  seg.setSourceWeight (0.8);
-
-  std::vector <pcl::PointIndices> clusters;
-  seg.extract (clusters);
+  // Seeded from the table plane and the supervoxel highest above it, the leg
+  // centroid is kept for the next frame
+  MinCutStage seg;
+  std::vector <int> leg;
+  if (!seg.compute (cloud, indices, leg))
+  {
+    std::cout << "No leg found." << std::endl;
+    return (-1);
+  }
 
-  std::cout << "Maximum flow is " << seg.getMaxFlow () << std::endl;
+  std::cout << "Maximum flow is " << seg.maxFlow () << std::endl;
+  std::cout << "Leg has " << leg.size () << " points in " << seg.supervoxelCount () << " supervoxels" << std::endl;
 
-  pcl::PointCloud<pcl::PointXYZRGB>::Ptr colored_cloud = seg.getColoredCloud ();
-  //std::vector<PointXYZ, Eigen::aligned_allocator<PointXYZ>> = seg.getForegroundPoints();
+  // Leg red, everything else white
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr colored_cloud (new pcl::PointCloud<pcl::PointXYZRGB>);
+  pcl::copyPointCloud (*cloud, *colored_cloud);
+  for (size_t i = 0; i < colored_cloud->points.size (); ++i)
+  {
+    colored_cloud->points[i].r = colored_cloud->points[i].g = colored_cloud->points[i].b = 255;
+  }
+  for (size_t i = 0; i < leg.size (); ++i)
+  {
+    colored_cloud->points[leg[i]].g = colored_cloud->points[leg[i]].b = 0;
+  }
   pcl::visualization::CloudViewer viewer ("Cluster viewer");
-  viewer.showCloud(cloud);
+  viewer.showCloud(colored_cloud);
   while (!viewer.wasStopped ())
   {
   }
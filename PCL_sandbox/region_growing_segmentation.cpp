@@ -1,15 +1,14 @@
 #include <iostream>
 #include <vector>
+#include <cstdlib>
 #include <pcl/point_types.h>
 #include <pcl/io/pcd_io.h>
-#include <pcl/search/search.h>
-#include <pcl/search/kdtree.h>
 #include <pcl/io/ply_io.h>
-#include <pcl/features/normal_3d.h>
+#include <pcl/common/io.h>
 #include <pcl/visualization/cloud_viewer.h>
 #include <pcl/filters/passthrough.h>
-#include <pcl/segmentation/region_growing.h>
-#include <pcl/segmentation/region_growing_rgb.h>
+#include "NormalStage.h"
+#include "RegionGrowingStage.h"
 
 int
 main (int argc, char** argv)
@@ -21,50 +20,73 @@ main (int argc, char** argv)
     return (-1);
   }
 
-  pcl::search::Search<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ>);
+  // Normals on the full grid, so the frame has to stay organized
   pcl::PointCloud <pcl::Normal>::Ptr normals (new pcl::PointCloud <pcl::Normal>);
-  pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> normal_estimator;
-  normal_estimator.setSearchMethod (tree);
-  normal_estimator.setInputCloud (cloud);
-  normal_estimator.setKSearch (50);
-  normal_estimator.compute (*normals);
+  NormalStage normal_stage;
+  normal_stage.compute (cloud, *normals);
 
-  pcl::IndicesPtr indices (new std::vector <int>);
+  std::vector <int> indices;
   pcl::PassThrough<pcl::PointXYZ> pass;
   pass.setInputCloud (cloud);
   pass.setFilterFieldName ("z");
   pass.setFilterLimits (0.0, 1.0);
-  pass.filter (*indices);
+  pass.filter (indices);
 
-  pcl::RegionGrowing<pcl::PointXYZ, pcl::Normal> reg;
-  reg.setMinClusterSize (50);
-  reg.setMaxClusterSize (1000000);
-  reg.setSearchMethod (tree);
-  reg.setNumberOfNeighbours (30);
-  reg.setInputCloud (cloud);
-  //reg.setIndices (indices);
-  reg.setInputNormals (normals);
-  reg.setSmoothnessThreshold (3.0 / 180.0 * M_PI);
-  reg.setCurvatureThreshold (1.0);
-
-  std::vector <pcl::PointIndices> clusters;
-  reg.extract (clusters);
+  // Seeds only inside the ROI, growing to the grid neighbours
+  RegionGrowingStage reg;
+  if (!reg.compute (*cloud, *normals, indices))
+  {
+    std::cout << "Cloud is not organized." << std::endl;
+    return (-1);
+  }
 
-  std::cout << "Number of clusters is equal to " << clusters.size () << std::endl;
-  std::cout << "First cluster has " << clusters[0].indices.size () << " points." << endl;
+  std::cout << "Number of clusters is equal to " << reg.regionCount () << std::endl;
+  if (reg.regionCount () == 0)
+  {
+    return (0);
+  }
+  std::cout << "First cluster has " << reg.regionSize (0) << " points." << endl;
   std::cout << "These are the indices of the points of the initial" <<
     std::endl << "cloud that belong to the first cluster:" << std::endl;
+  const std::vector<int> &labels = reg.labels ();
   int counter = 0;
-  while (counter < clusters[0].indices.size ())
+  for (size_t i = 0; i < labels.size (); ++i)
   {
-    std::cout << clusters[0].indices[counter] << ", ";
+    if (labels[i] != 0)
+      continue;
+    std::cout << i << ", ";
     counter++;
     if (counter % 10 == 0)
       std::cout << std::endl;
   }
   std::cout << std::endl;
 
-  pcl::PointCloud <pcl::PointXYZRGB>::Ptr colored_cloud = reg.getColoredCloud ();
+  // One random colour per region, unlabelled points red like getColoredCloud ()
+  std::vector<pcl::RGB> colours (reg.regionCount ());
+  for (size_t l = 0; l < colours.size (); ++l)
+  {
+    colours[l].r = rand () % 256;
+    colours[l].g = rand () % 256;
+    colours[l].b = rand () % 256;
+  }
+  pcl::PointCloud <pcl::PointXYZRGB>::Ptr colored_cloud (new pcl::PointCloud <pcl::PointXYZRGB>);
+  pcl::copyPointCloud (*cloud, *colored_cloud);
+  for (size_t i = 0; i < labels.size (); ++i)
+  {
+    pcl::PointXYZRGB &p = colored_cloud->points[i];
+    if (labels[i] < 0)
+    {
+      p.r = 255;
+      p.g = p.b = 0;
+    }
+    else
+    {
+      p.r = colours[labels[i]].r;
+      p.g = colours[labels[i]].g;
+      p.b = colours[labels[i]].b;
+    }
+  }
+
   pcl::visualization::CloudViewer viewer ("Cluster viewer");
   viewer.showCloud(colored_cloud);
   while (!viewer.wasStopped ())
@@ -17,6 +17,8 @@
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/sample_consensus/model_types.h>
 #include <pcl/segmentation/sac_segmentation.h>
+#include "../PCL_sandbox/NormalStage.h"
+#include "../PCL_sandbox/LegAnalyzer.h"
 
 using namespace std;
 using Eigen::MatrixXd;
@@ -30,81 +32,33 @@ int main (int argc, char** argv) {
       pcl::io::loadPCDFile ("concaveboi.pcd", *cloud); //prev: hulltest.pdc
       cout << "Point cloud size: " << cloud->points.size() << endl;
 
-      pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-      ne.setViewPoint (1, 2, 4); //Set initial viewpoint
-      ne.setInputCloud(cloud);
-
-      pcl::search::KdTree<pcl::PointXYZ>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZ> ());
-      ne.setSearchMethod (tree);
-
       // Output datasets
       pcl::PointCloud<pcl::Normal>::Ptr normals (new pcl::PointCloud<pcl::Normal>);
 
-      // Use all neighbors in a sphere of radius 3cm
-      ne.setRadiusSearch (0.03);
-
-      // Compute the features
-      ne.compute(*normals);
+      // Integral images on organized Kinect2 frames, a 3cm radius search otherwise
+      // (needs ../PCL_sandbox/NormalStage.cpp in the project)
+      NormalStage normal_stage;
+      normal_stage.setViewPoint(1, 2, 4);
+      normal_stage.compute(cloud, *normals);
 
       pcl::ModelCoefficients::Ptr line_coefficients(new pcl::ModelCoefficients);
       pcl::PointIndices::Ptr inliers (new pcl::PointIndices);
 
       ///////////////////////////////////////////////////////////////////////////
-      // Try out different pairs, looking for the longest distance between them
-      float longest = 0.0;
-      float len = 0.0;
+      // Longest line from the shared analyzer (needs ../PCL_sandbox/LegAnalyzer.cpp
+      // in the project). idx1 is the narrow end, where the skeletonization starts.
       float xdist = 0.0;
       float ydist = 0.0;
       float zdist = 0.0;
-      int idx1 = 0;
-      int idx2 = 0;
-
-      for (int i = 0; i < cloud->points.size() / 2; i++)
-      {
-            xdist = cloud->points[i].x - cloud->points[cloud->points.size() / 2 + i].x;
-            ydist = cloud->points[i].y - cloud->points[cloud->points.size() / 2 + i].y;
-            zdist = cloud->points[i].z - cloud->points[cloud->points.size() / 2 + i].z;
-            len = sqrt(pow(xdist, 2.0) + pow(ydist, 2.0) + pow(zdist, 2.0));
-
-            if (len>longest)
-            {
-                  longest = len;
-                  idx1 = i;
-                  idx2 = cloud->points.size() / 2 + i;
-            }
-      }
-      // Try with shifted upper index
-      for (int i = 0; i < cloud->points.size() / 2; ++i)
-      {
-            if ((i % 2) && (cloud->points.size() / 2 + i + 10 <= cloud->points.size())
-                  && (cloud->points.size() / 2 + i + 10 >= 0))
-            {
-                  xdist = cloud->points[i].x - cloud->points[cloud->points.size() / 2 + i + 10].x;
-                  ydist = cloud->points[i].y - cloud->points[cloud->points.size() / 2 + i + 10].y;
-                  zdist = cloud->points[i].z - cloud->points[cloud->points.size() / 2 + i + 10].z;
-                  len = sqrt(pow(xdist, 2.0) + pow(ydist, 2.0) + pow(zdist, 2.0));
-            }
-            else {
-                  xdist = cloud->points[i].x - cloud->points[cloud->points.size() / 2 + i - 10].x;
-                  ydist = cloud->points[i].y - cloud->points[cloud->points.size() / 2 + i - 10].y;
-                  zdist = cloud->points[i].z - cloud->points[cloud->points.size() / 2 + i - 10].z;
-                  len = sqrt(pow(xdist, 2.0) + pow(ydist, 2.0) + pow(zdist, 2.0));
-            }
-
-            if (len>longest)
-            {
-                  longest = len;
-                  idx1 = i;
-                  if (i % 2)
-                  {
-                        idx2 = cloud->points.size() / 2 + i + 10;
-                  }
-                  else
-                  {
-                        idx2 = cloud->points.size() / 2 + i - 10;
-                  }
-            }
-      }
+      float len = 0.0;
+      LegAnalyzer analyzer;
+      CutPose cut = analyzer.process(*cloud);
+      int idx1 = cut.tip;
+      int idx2 = cut.base;
+      xdist = cloud->points[idx1].x - cloud->points[idx2].x;
+      ydist = cloud->points[idx1].y - cloud->points[idx2].y;
+      zdist = cloud->points[idx1].z - cloud->points[idx2].z;
+      float longest = sqrt(pow(xdist, 2.0) + pow(ydist, 2.0) + pow(zdist, 2.0));
 
       cout << "The longest line goes between points [" << idx1 << "," << idx2
              << "] and has length: " << longest << endl;
@@ -14,6 +14,7 @@
 #include <pcl/sample_consensus/method_types.h>
 #include <pcl/sample_consensus/model_types.h>
 #include <pcl/segmentation/sac_segmentation.h>
+#include "../PCL_sandbox/NormalStage.h"
 
 using namespace std;
 
@@ -24,23 +25,14 @@ int main(int argc, char** argv) {
 	pcl::io::loadPCDFile("concaveboi.pcd", *cloud); //hulltest.pdc
 	cout << cloud->points.size() << endl;
 
-	pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> ne;
-	ne.setViewPoint(1, 2, 4);
-	ne.setInputCloud(cloud);
-
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr tree(new pcl::search::KdTree<pcl::PointXYZ>());
-	ne.setSearchMethod(tree);
-
 	// Output datasets
 	pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>);
 
-
-
-	// Use all neighbors in a sphere of radius 3cm
-	ne.setRadiusSearch(0.03);
-
-	// Compute the features
-	ne.compute(*normals);
+	// Integral images on organized Kinect2 frames, a 3cm radius search otherwise
+	// (needs ../PCL_sandbox/NormalStage.cpp in the project)
+	NormalStage normal_stage;
+	normal_stage.setViewPoint(1, 2, 4);
+	normal_stage.compute(cloud, *normals);
 	//for(int k = 0; k<normals->points.size(); k++)
 	//{
 